@@ -9,14 +9,52 @@
 
 #include <iostream>
 #include <vector>
-#include <deque>
 #include <cmath>
 #include <numeric>
 #include <iomanip>
-#include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <deque>
+#include <cstdint>
 #include <cstdlib>
 #include <ctime>
+#include <chrono>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <charconv>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <stdexcept>
+#include <functional>
+#include <type_traits>
+#include <memory_resource>
+#include <new>
+#include <algorithm>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define HAVE_X86_SIMD 0
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_POSIX_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define HAVE_POSIX_MMAP 0
+#endif
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 using namespace std;
 
 const int TICKS_PER_DAY = 72;
@@ -24,172 +62,5404 @@ const int COMPANIES = 5;
 const int SMA_WINDOW = 10; // 10-tick Simple Moving Average
 const double LIMIT_SLIPPAGE = 0.01;//Slippage is the difference between the expected priceand actual price of trade
 const double INITIAL_BALANCE = 100000.0;
+const int SMA_RENORM_INTERVAL = 1024; // pushes between full re-sums of a window, bounds float drift of the running sum
+
+// Accuracy tiers for the normal CDF, selectable per pricing call:
+// Reference is libm erfc, Rational is Abramowitz-Stegun 26.2.17 (abs error < 7.5e-8),
+// Table is a cubic Hermite interpolation of a precomputed grid (abs error ~1e-9, no exp/erfc at all).
+enum class CdfTier { Reference, Rational, Table };
+
+const double CDF_TABLE_RANGE = 8.0;// N(x) is within 1e-15 of 0 or 1 beyond this
+const int CDF_TABLE_STEPS_PER_UNIT = 32;
 
-double normal_cdf(double x) { 
+double normal_cdf_reference(double x) {
     return 0.5 * erfc(-x / sqrt(2));
+}
+
+double normal_cdf_rational(double x) {
+    const double p = 0.2316419;
+    const double b1 = 0.319381530, b2 = -0.356563782, b3 = 1.781477937, b4 = -1.821255978, b5 = 1.330274429;
+    double a = fabs(x);
+    double t = 1.0 / (1.0 + p * a);
+    double poly = t * (b1 + t * (b2 + t * (b3 + t * (b4 + t * b5))));
+    double tail = exp(-0.5 * a * a) * (1.0 / sqrt(2 * M_PI)) * poly;
+    return x >= 0 ? 1.0 - tail : tail;
+}
+
+struct CdfTable {// N(x) and its derivative (the normal pdf) on a uniform grid over [-CDF_TABLE_RANGE, CDF_TABLE_RANGE]
+    vector<double> value;
+    vector<double> slope;
+
+    CdfTable() {
+        int points = int(2 * CDF_TABLE_RANGE * CDF_TABLE_STEPS_PER_UNIT) + 1;
+        value.resize(points);
+        slope.resize(points);
+        for (int i = 0; i < points; ++i) {
+            double x = -CDF_TABLE_RANGE + double(i) / CDF_TABLE_STEPS_PER_UNIT;
+            value[i] = normal_cdf_reference(x);
+            slope[i] = exp(-0.5 * x * x) / sqrt(2 * M_PI);
+        }
+    }
+};
+
+double normal_cdf_table(double x) {
+    static const CdfTable table;
+    const double h = 1.0 / CDF_TABLE_STEPS_PER_UNIT;
+    if (x <= -CDF_TABLE_RANGE) return 0.0;
+    if (x >= CDF_TABLE_RANGE) return 1.0;
+    double pos = (x + CDF_TABLE_RANGE) * CDF_TABLE_STEPS_PER_UNIT;
+    int i = min(int(pos), int(table.value.size()) - 2);
+    double u = pos - i;
+    double u2 = u * u, u3 = u2 * u;
+    return (2 * u3 - 3 * u2 + 1) * table.value[i] + (u3 - 2 * u2 + u) * h * table.slope[i]
+         + (-2 * u3 + 3 * u2) * table.value[i + 1] + (u3 - u2) * h * table.slope[i + 1];
+}
+
+double normal_cdf(double x, CdfTier tier = CdfTier::Reference) {
+    switch (tier) {
+        case CdfTier::Rational: return normal_cdf_rational(x);
+        case CdfTier::Table: return normal_cdf_table(x);
+        default: return normal_cdf_reference(x);
+    }
+}
+
+const char* cdf_tier_name(CdfTier tier) {
+    switch (tier) {
+        case CdfTier::Reference: return "reference";
+        case CdfTier::Rational: return "rational";
+        case CdfTier::Table: return "table";
     }
+    return "?";
+}
+
+// d1 and d2 of Black-Scholes, shared by the prices and the Greeks.
+inline void bs_d1_d2(double S, double K, double T, double r, double sigma, double& d1, double& d2) {
+    d1 = (log(S / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt(T));
+    d2 = d1 - sigma * sqrt(T);
+}
 
-double call_price(double S, double K, double T, double r, double sigma) {
+double call_price(double S, double K, double T, double r, double sigma, CdfTier tier = CdfTier::Reference) {
     if (sigma == 0) return max(0.0, S - K);
-    double d1 = (log(S / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt(T));
-    double d2 = d1 - sigma * sqrt(T);
-    return S * normal_cdf(d1) - K * exp(-r * T) * normal_cdf(d2);
+    double d1, d2;
+    bs_d1_d2(S, K, T, r, sigma, d1, d2);
+    return S * normal_cdf(d1, tier) - K * exp(-r * T) * normal_cdf(d2, tier);
 }
 
-double put_price(double S, double K, double T, double r, double sigma) {
+double put_price(double S, double K, double T, double r, double sigma, CdfTier tier = CdfTier::Reference) {
     if (sigma == 0) return max(0.0, K - S);
-    double d1 = (log(S / K) + (r + 0.5 * sigma * sigma) * T) / (sigma * sqrt(T));
-    double d2 = d1 - sigma * sqrt(T);
-    return K * exp(-r * T) * normal_cdf(-d2) - S * normal_cdf(-d1);
+    double d1, d2;
+    bs_d1_d2(S, K, T, r, sigma, d1, d2);
+    return K * exp(-r * T) * normal_cdf(-d2, tier) - S * normal_cdf(-d1, tier);
+}
+
+// ---- Batch Black-Scholes pricer ----
+// Prices whole option chains at once. The AVX2/AVX-512 kernels use their own branch-free exp, log and
+// normal CDF (Hart's double-precision rational approximation), so a chain never calls into libm.
+// PricerMode::Scalar runs call_price/put_price per contract and is the reference the kernels are validated against.
+
+enum class PricerMode { Auto, Scalar, AVX2, AVX512 };
+
+bool cpu_has_avx2() {
+#if HAVE_X86_SIMD
+    static const bool has = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return has;
+#else
+    return false;
+#endif
+}
+
+bool cpu_has_avx512() {
+#if HAVE_X86_SIMD
+    static const bool has = __builtin_cpu_supports("avx512f");
+    return has;
+#else
+    return false;
+#endif
+}
+
+PricerMode resolve_pricer_mode(PricerMode mode) {// falls back to the widest kernel the CPU can actually run
+    if (mode == PricerMode::Auto) mode = PricerMode::AVX512;
+    if (mode == PricerMode::AVX512 && !cpu_has_avx512()) mode = PricerMode::AVX2;
+    if (mode == PricerMode::AVX2 && !cpu_has_avx2()) mode = PricerMode::Scalar;
+    return mode;
+}
+
+const char* pricer_mode_name(PricerMode mode) {
+    switch (mode) {
+        case PricerMode::Auto: return "auto";
+        case PricerMode::Scalar: return "scalar";
+        case PricerMode::AVX2: return "avx2";
+        case PricerMode::AVX512: return "avx512";
+    }
+    return "?";
+}
+
+void price_options_scalar(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                          double* calls, double* puts, size_t begin, size_t n) {
+    for (size_t i = begin; i < n; ++i) {
+        calls[i] = call_price(S[i], K[i], T[i], r[i], sigma[i]);
+        puts[i] = put_price(S[i], K[i], T[i], r[i], sigma[i]);
+    }
+}
+
+// Value and sensitivities of one contract, per unit of each input: vega and rho per 1.00 of vol and rate,
+// theta per year.
+struct Greeks {
+    double value = 0.0, delta = 0.0, gamma = 0.0, vega = 0.0, theta = 0.0, rho = 0.0;
+
+    Greeks& operator+=(const Greeks& other) {
+        value += other.value;
+        delta += other.delta;
+        gamma += other.gamma;
+        vega += other.vega;
+        theta += other.theta;
+        rho += other.rho;
+        return *this;
+    }
+};
+
+struct OptionGreeksOut {// parallel output arrays of option_greeks_batch
+    double* value;
+    double* delta;
+    double* gamma;
+    double* vega;
+    double* theta;
+    double* rho;
+};
+
+Greeks option_greeks(double S, double K, double T, double r, double sigma, bool isCall) {
+    Greeks g;
+    if (sigma == 0 || T <= 0) {// no time value left: intrinsic value, step delta
+        double intrinsic = isCall ? S - K : K - S;
+        g.value = max(0.0, intrinsic);
+        g.delta = intrinsic > 0 ? (isCall ? 1.0 : -1.0) : 0.0;
+        return g;
+    }
+    double d1, d2;
+    bs_d1_d2(S, K, T, r, sigma, d1, d2);
+    double pdf = exp(-0.5 * d1 * d1) / sqrt(2 * M_PI);
+    double kdf = K * exp(-r * T);
+    double decay = -S * pdf * sigma / (2 * sqrt(T));
+    g.gamma = pdf / (S * sigma * sqrt(T));
+    g.vega = S * pdf * sqrt(T);
+    if (isCall) {
+        g.value = S * normal_cdf(d1) - kdf * normal_cdf(d2);
+        g.delta = normal_cdf(d1);
+        g.theta = decay - r * kdf * normal_cdf(d2);
+        g.rho = T * kdf * normal_cdf(d2);
+    } else {
+        g.value = kdf * normal_cdf(-d2) - S * normal_cdf(-d1);
+        g.delta = normal_cdf(d1) - 1;
+        g.theta = decay + r * kdf * normal_cdf(-d2);
+        g.rho = -T * kdf * normal_cdf(-d2);
+    }
+    return g;
+}
+
+// ---- Implied volatility ----
+// Inverts a premium to the Black-Scholes vol. Put-call parity moves every quote to its out-of-the-money leg,
+// which holds only time value, so one solver covers calls and puts without losing small premiums. The
+// Corrado-Miller closed form gives the first guess; Halley steps refine it, and any step that leaves the
+// [lo, hi] bracket of the root falls back to bisection. The SIMD kernels run the same iteration per lane
+// and leave a vector as soon as every lane has converged.
+const double IV_MIN_VOL = 1e-4;
+const double IV_MAX_VOL = 5.0;
+const double IV_TOLERANCE = 1e-10;// stop once a step moves the vol by less than this
+const int IV_MAX_ITERATIONS = 40;
+
+// NaN when the premium carries no time value, breaks the no-arbitrage upper bound, or T <= 0.
+double implied_vol(double premium, double S, double K, double T, double r, bool isCall) {
+    double kdf = K * exp(-r * T);
+    double forwardGap = S - kdf;
+    bool usePut = forwardGap > 0;// the call is in the money
+    double target = premium;
+    if (isCall && usePut) target -= forwardGap;
+    if (!isCall && !usePut) target += forwardGap;
+    if (!(T > 0) || !(target > 0) || !(target < (usePut ? kdf : S))) return NAN;
+    double sqrtT = sqrt(T), logMoneyness = log(S / kdf);
+    double centre = (usePut ? target + forwardGap : target) - 0.5 * forwardGap;// the guess is for the call
+    double disc = max(0.0, centre * centre - forwardGap * forwardGap / M_PI);
+    double vol = min(IV_MAX_VOL, max(IV_MIN_VOL, sqrt(2 * M_PI / T) / (S + kdf) * (centre + sqrt(disc))));
+    double lo = IV_MIN_VOL, hi = IV_MAX_VOL;
+    for (int it = 0; it < IV_MAX_ITERATIONS; ++it) {
+        double volT = vol * sqrtT;
+        double d1 = logMoneyness / volT + 0.5 * volT, d2 = d1 - volT;
+        double diff = (usePut ? kdf * normal_cdf(-d2) - S * normal_cdf(-d1) : S * normal_cdf(d1) - kdf * normal_cdf(d2)) - target;
+        if (diff > 0) hi = vol;
+        if (diff < 0) lo = vol;
+        double vega = S * sqrtT * exp(-0.5 * d1 * d1) / sqrt(2 * M_PI);
+        double newton = diff / vega;
+        double next = vol - newton / (1 - 0.5 * newton * d1 * d2 / vol);// Halley, volga / vega = d1 * d2 / vol
+        if (!(next >= lo && next <= hi)) next = 0.5 * (lo + hi);// also catches a vanishing vega
+        bool converged = fabs(next - vol) < IV_TOLERANCE;
+        vol = next;
+        if (converged) break;
+    }
+    return vol;
+}
+
+const double SIMD_LOG2E = 1.4426950408889634;
+const double SIMD_LN2 = 0.6931471805599453;
+const double SIMD_LN2_HI = 6.93147180369123816490e-01;// ln2 split so n*LN2_HI is exact during range reduction
+const double SIMD_LN2_LO = 1.90821492927058770002e-10;
+const double SIMD_ROUND_MAGIC = 6755399441055744.0;// 2^52 + 2^51, adding it leaves a small integer in the low mantissa bits
+const double SIMD_EXP_MIN = -708.0;
+const double SIMD_EXP_MAX = 709.0;
+const double SIMD_EXP_POLY[13] = {1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040, 1.0 / 40320,
+                                  1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600};// Taylor on |r| <= ln2/2
+const double SIMD_CDF_NUM[7] = {3.52624965998911E-02, 0.700383064443688, 6.37396220353165, 33.912866078383,
+                                112.079291497871, 221.213596169931, 220.206867912376};
+const double SIMD_CDF_DEN[8] = {8.83883476483184E-02, 1.75566716318264, 16.064177579207, 86.7807322029461,
+                                296.564248779674, 637.333633378831, 793.826512519948, 440.413735824752};
+const double SIMD_CDF_SPLIT = 7.07106781186547;// above this the continued fraction tail is used
+const double SIMD_CDF_CUTOFF = 37.0;
+const double SIMD_SQRT_2PI = 2.506628274631;
+
+// Scalar twins of exp_avx2/log_avx2: the same operations in the same order (fma where the kernels use
+// fmadd), so they return the same bits on any CPU. Code whose output must not depend on the ISA (the
+// market generator) uses these on machines without AVX2.
+inline double exp_portable(double x) {
+    x = max(min(x, SIMD_EXP_MAX), SIMD_EXP_MIN);
+    double n = nearbyint(x * SIMD_LOG2E);
+    double rem = fma(-n, SIMD_LN2_HI, x);
+    rem = fma(-n, SIMD_LN2_LO, rem);
+    double p = SIMD_EXP_POLY[12];
+    for (int k = 11; k >= 0; --k) p = fma(p, rem, SIMD_EXP_POLY[k]);
+    uint64_t bits = uint64_t(int64_t(n) + 1023) << 52;
+    double scale;
+    memcpy(&scale, &bits, sizeof(scale));
+    return p * scale;
+}
+
+inline double log_portable(double x) {// x must be positive and normal
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    uint64_t mantissa = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+    double m;
+    memcpy(&m, &mantissa, sizeof(m));
+    double ed = double(bits >> 52) - 1023.0;
+    if (m > M_SQRT2) {
+        m *= 0.5;
+        ed += 1.0;
+    }
+    double s = (m - 1.0) / (m + 1.0);
+    double z = s * s;
+    double p = 1.0 / 21;
+    for (int k = 9; k >= 0; --k) p = fma(p, z, 1.0 / (2 * k + 1));
+    return fma(ed, SIMD_LN2, (s + s) * p);
+}
+
+#if HAVE_X86_SIMD
+
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+static inline __m256d exp_avx2(__m256d x) {
+    const __m256d magic = _mm256_set1_pd(SIMD_ROUND_MAGIC);
+    x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(SIMD_EXP_MAX)), _mm256_set1_pd(SIMD_EXP_MIN));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(SIMD_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d rem = _mm256_fnmadd_pd(n, _mm256_set1_pd(SIMD_LN2_HI), x);
+    rem = _mm256_fnmadd_pd(n, _mm256_set1_pd(SIMD_LN2_LO), rem);
+    __m256d p = _mm256_set1_pd(SIMD_EXP_POLY[12]);
+    for (int k = 11; k >= 0; --k) p = _mm256_fmadd_pd(p, rem, _mm256_set1_pd(SIMD_EXP_POLY[k]));
+    __m256i ni = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)), _mm256_castpd_si256(magic));
+    __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(ni, _mm256_set1_epi64x(1023)), 52));
+    return _mm256_mul_pd(p, scale);
+}
+
+static inline __m256d log_avx2(__m256d x) {// x must be positive and normal
+    const __m256d magic = _mm256_set1_pd(SIMD_ROUND_MAGIC);
+    __m256i bits = _mm256_castpd_si256(x);
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)),
+                                                    _mm256_set1_epi64x(0x3FF0000000000000LL)));
+    __m256i e = _mm256_srli_epi64(bits, 52);
+    __m256d ed = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_add_epi64(e, _mm256_castpd_si256(magic))), magic);
+    ed = _mm256_sub_pd(ed, _mm256_set1_pd(1023.0));
+    __m256d high = _mm256_cmp_pd(m, _mm256_set1_pd(M_SQRT2), _CMP_GT_OQ);// keep m in [sqrt(1/2), sqrt(2))
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), high);
+    ed = _mm256_add_pd(ed, _mm256_and_pd(high, _mm256_set1_pd(1.0)));
+    __m256d s = _mm256_div_pd(_mm256_sub_pd(m, _mm256_set1_pd(1.0)), _mm256_add_pd(m, _mm256_set1_pd(1.0)));
+    __m256d z = _mm256_mul_pd(s, s);
+    __m256d p = _mm256_set1_pd(1.0 / 21);// log(m) = 2 atanh(s) = 2s(1 + z/3 + z^2/5 + ...)
+    for (int k = 9; k >= 0; --k) p = _mm256_fmadd_pd(p, z, _mm256_set1_pd(1.0 / (2 * k + 1)));
+    __m256d logm = _mm256_mul_pd(_mm256_add_pd(s, s), p);
+    return _mm256_fmadd_pd(ed, _mm256_set1_pd(SIMD_LN2), logm);
+}
+
+// N(x) and N(-x) together: both come from the same tail mass of |x|.
+static inline void normal_cdf_pair_avx2(__m256d x, __m256d& cdf, __m256d& cdfNeg) {
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d a = _mm256_andnot_pd(_mm256_set1_pd(-0.0), x);
+    __m256d e = exp_avx2(_mm256_mul_pd(_mm256_mul_pd(a, a), _mm256_set1_pd(-0.5)));
+    __m256d num = _mm256_set1_pd(SIMD_CDF_NUM[0]);
+    for (int k = 1; k < 7; ++k) num = _mm256_fmadd_pd(num, a, _mm256_set1_pd(SIMD_CDF_NUM[k]));
+    __m256d den = _mm256_set1_pd(SIMD_CDF_DEN[0]);
+    for (int k = 1; k < 8; ++k) den = _mm256_fmadd_pd(den, a, _mm256_set1_pd(SIMD_CDF_DEN[k]));
+    __m256d body = _mm256_div_pd(_mm256_mul_pd(e, num), den);
+    __m256d b = _mm256_add_pd(a, _mm256_set1_pd(0.65));
+    for (int k = 4; k >= 1; --k) b = _mm256_add_pd(a, _mm256_div_pd(_mm256_set1_pd(k), b));
+    __m256d tail = _mm256_div_pd(e, _mm256_mul_pd(b, _mm256_set1_pd(SIMD_SQRT_2PI)));
+    __m256d c = _mm256_blendv_pd(body, tail, _mm256_cmp_pd(a, _mm256_set1_pd(SIMD_CDF_SPLIT), _CMP_GE_OQ));
+    c = _mm256_andnot_pd(_mm256_cmp_pd(a, _mm256_set1_pd(SIMD_CDF_CUTOFF), _CMP_GT_OQ), c);
+    __m256d positive = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GT_OQ);
+    __m256d negative = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ);
+    cdf = _mm256_blendv_pd(c, _mm256_sub_pd(one, c), positive);
+    cdfNeg = _mm256_blendv_pd(c, _mm256_sub_pd(one, c), negative);
+}
+
+// d1, d2, sigma*sqrt(T) and the discounted strike: the part of a contract the prices and the Greeks share.
+static inline void bs_terms_avx2(__m256d s, __m256d k, __m256d t, __m256d rate, __m256d vol,
+                                 __m256d& d1, __m256d& d2, __m256d& volT, __m256d& kdf) {
+    volT = _mm256_mul_pd(vol, _mm256_sqrt_pd(t));
+    __m256d drift = _mm256_fmadd_pd(_mm256_mul_pd(vol, vol), _mm256_set1_pd(0.5), rate);
+    d1 = _mm256_div_pd(_mm256_fmadd_pd(drift, t, log_avx2(_mm256_div_pd(s, k))), volT);
+    d2 = _mm256_sub_pd(d1, volT);
+    kdf = _mm256_mul_pd(k, exp_avx2(_mm256_mul_pd(_mm256_sub_pd(_mm256_setzero_pd(), rate), t)));
+}
+
+static size_t price_options_avx2(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                                 double* calls, double* puts, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_loadu_pd(S + i), k = _mm256_loadu_pd(K + i), t = _mm256_loadu_pd(T + i);
+        __m256d rate = _mm256_loadu_pd(r + i), vol = _mm256_loadu_pd(sigma + i);
+        __m256d d1, d2, volT, kdf;
+        bs_terms_avx2(s, k, t, rate, vol, d1, d2, volT, kdf);
+        __m256d nd1, nmd1, nd2, nmd2;
+        normal_cdf_pair_avx2(d1, nd1, nmd1);
+        normal_cdf_pair_avx2(d2, nd2, nmd2);
+        __m256d call = _mm256_fmsub_pd(s, nd1, _mm256_mul_pd(kdf, nd2));
+        __m256d put = _mm256_fmsub_pd(kdf, nmd2, _mm256_mul_pd(s, nmd1));
+        __m256d zeroVol = _mm256_cmp_pd(vol, _mm256_setzero_pd(), _CMP_EQ_OQ);// same intrinsic-value shortcut as call_price
+        call = _mm256_blendv_pd(call, _mm256_max_pd(_mm256_setzero_pd(), _mm256_sub_pd(s, k)), zeroVol);
+        put = _mm256_blendv_pd(put, _mm256_max_pd(_mm256_setzero_pd(), _mm256_sub_pd(k, s)), zeroVol);
+        _mm256_storeu_pd(calls + i, call);
+        _mm256_storeu_pd(puts + i, put);
+    }
+    return i;
+}
+
+static size_t option_greeks_avx2(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                                 const uint8_t* isCall, OptionGreeksOut out, size_t n) {
+    const __m256d zero = _mm256_setzero_pd(), one = _mm256_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_loadu_pd(S + i), k = _mm256_loadu_pd(K + i), t = _mm256_loadu_pd(T + i);
+        __m256d rate = _mm256_loadu_pd(r + i), vol = _mm256_loadu_pd(sigma + i);
+        __m256d d1, d2, volT, kdf;
+        bs_terms_avx2(s, k, t, rate, vol, d1, d2, volT, kdf);
+        __m256d nd1, nmd1, nd2, nmd2;
+        normal_cdf_pair_avx2(d1, nd1, nmd1);
+        normal_cdf_pair_avx2(d2, nd2, nmd2);
+        __m256d pdf = _mm256_div_pd(exp_avx2(_mm256_mul_pd(_mm256_mul_pd(d1, d1), _mm256_set1_pd(-0.5))), _mm256_set1_pd(SIMD_SQRT_2PI));
+        int32_t flagBytes;// four flags, unaligned: memcpy rather than a type-punned load
+        memcpy(&flagBytes, isCall + i, sizeof(flagBytes));
+        __m128i flags = _mm_cvtsi32_si128(flagBytes);
+        __m256d call = _mm256_castsi256_pd(_mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(flags), _mm256_setzero_si256()));
+        __m256d sPdf = _mm256_mul_pd(s, pdf);
+        __m256d decay = _mm256_div_pd(_mm256_mul_pd(sPdf, vol), _mm256_mul_pd(_mm256_set1_pd(-2.0), _mm256_sqrt_pd(t)));
+        __m256d rkdf = _mm256_mul_pd(rate, kdf), tkdf = _mm256_mul_pd(t, kdf);
+        __m256d value = _mm256_blendv_pd(_mm256_fmsub_pd(kdf, nmd2, _mm256_mul_pd(s, nmd1)), _mm256_fmsub_pd(s, nd1, _mm256_mul_pd(kdf, nd2)), call);
+        __m256d delta = _mm256_blendv_pd(_mm256_sub_pd(nd1, one), nd1, call);
+        __m256d gamma = _mm256_div_pd(pdf, _mm256_mul_pd(s, volT));
+        __m256d vega = _mm256_mul_pd(sPdf, _mm256_sqrt_pd(t));
+        __m256d theta = _mm256_blendv_pd(_mm256_fmadd_pd(rkdf, nmd2, decay), _mm256_fnmadd_pd(rkdf, nd2, decay), call);
+        __m256d rho = _mm256_blendv_pd(_mm256_sub_pd(zero, _mm256_mul_pd(tkdf, nmd2)), _mm256_mul_pd(tkdf, nd2), call);
+        __m256d degenerate = _mm256_or_pd(_mm256_cmp_pd(volT, zero, _CMP_EQ_OQ), _mm256_cmp_pd(t, zero, _CMP_LE_OQ));// same intrinsic-value shortcut as option_greeks
+        __m256d intrinsic = _mm256_blendv_pd(_mm256_sub_pd(k, s), _mm256_sub_pd(s, k), call);
+        __m256d inMoney = _mm256_cmp_pd(intrinsic, zero, _CMP_GT_OQ);
+        value = _mm256_blendv_pd(value, _mm256_max_pd(zero, intrinsic), degenerate);
+        __m256d intrinsicDelta = _mm256_and_pd(inMoney, _mm256_blendv_pd(_mm256_set1_pd(-1.0), one, call));
+        delta = _mm256_blendv_pd(delta, intrinsicDelta, degenerate);
+        gamma = _mm256_andnot_pd(degenerate, gamma);
+        vega = _mm256_andnot_pd(degenerate, vega);
+        theta = _mm256_andnot_pd(degenerate, theta);
+        rho = _mm256_andnot_pd(degenerate, rho);
+        _mm256_storeu_pd(out.value + i, value);
+        _mm256_storeu_pd(out.delta + i, delta);
+        _mm256_storeu_pd(out.gamma + i, gamma);
+        _mm256_storeu_pd(out.vega + i, vega);
+        _mm256_storeu_pd(out.theta + i, theta);
+        _mm256_storeu_pd(out.rho + i, rho);
+    }
+    return i;
+}
+
+static size_t implied_vol_avx2(const double* premium, const double* S, const double* K, const double* T, const double* r,
+                               const uint8_t* isCall, double* vol, size_t n) {
+    const __m256d zero = _mm256_setzero_pd(), half = _mm256_set1_pd(0.5), one = _mm256_set1_pd(1.0);
+    const __m256d minVol = _mm256_set1_pd(IV_MIN_VOL), maxVol = _mm256_set1_pd(IV_MAX_VOL);
+    const __m256d absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL));
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d s = _mm256_loadu_pd(S + i), t = _mm256_loadu_pd(T + i), price = _mm256_loadu_pd(premium + i);
+        __m256d kdf = _mm256_mul_pd(_mm256_loadu_pd(K + i), exp_avx2(_mm256_mul_pd(_mm256_sub_pd(zero, _mm256_loadu_pd(r + i)), t)));
+        int32_t flagBytes;// four flags, unaligned: memcpy rather than a type-punned load
+        memcpy(&flagBytes, isCall + i, sizeof(flagBytes));
+        __m128i flags = _mm_cvtsi32_si128(flagBytes);
+        __m256d call = _mm256_castsi256_pd(_mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(flags), _mm256_setzero_si256()));
+        __m256d forwardGap = _mm256_sub_pd(s, kdf);
+        __m256d usePut = _mm256_cmp_pd(forwardGap, zero, _CMP_GT_OQ);
+        __m256d parity = _mm256_blendv_pd(_mm256_andnot_pd(usePut, forwardGap), _mm256_and_pd(usePut, _mm256_sub_pd(zero, forwardGap)), call);
+        __m256d target = _mm256_add_pd(price, parity);
+        __m256d valid = _mm256_and_pd(_mm256_cmp_pd(t, zero, _CMP_GT_OQ),
+                                      _mm256_and_pd(_mm256_cmp_pd(target, zero, _CMP_GT_OQ),
+                                                    _mm256_cmp_pd(target, _mm256_blendv_pd(s, kdf, usePut), _CMP_LT_OQ)));
+        __m256d sqrtT = _mm256_sqrt_pd(t), logMoneyness = log_avx2(_mm256_div_pd(s, kdf));
+        __m256d centre = _mm256_fnmadd_pd(half, forwardGap, _mm256_add_pd(target, _mm256_and_pd(usePut, forwardGap)));
+        __m256d disc = _mm256_max_pd(zero, _mm256_fnmadd_pd(_mm256_mul_pd(forwardGap, forwardGap), _mm256_set1_pd(1 / M_PI),
+                                                            _mm256_mul_pd(centre, centre)));
+        __m256d guess = _mm256_mul_pd(_mm256_div_pd(_mm256_sqrt_pd(_mm256_div_pd(_mm256_set1_pd(2 * M_PI), t)), _mm256_add_pd(s, kdf)),
+                                      _mm256_add_pd(centre, _mm256_sqrt_pd(disc)));
+        __m256d v = _mm256_min_pd(maxVol, _mm256_max_pd(minVol, guess));
+        __m256d lo = minVol, hi = maxVol;
+        __m256d done = _mm256_xor_pd(valid, allLanes);
+        for (int it = 0; it < IV_MAX_ITERATIONS && _mm256_movemask_pd(done) != 0xF; ++it) {
+            __m256d volT = _mm256_mul_pd(v, sqrtT);
+            __m256d d1 = _mm256_fmadd_pd(half, volT, _mm256_div_pd(logMoneyness, volT));
+            __m256d d2 = _mm256_sub_pd(d1, volT);
+            __m256d nd1, nmd1, nd2, nmd2;
+            normal_cdf_pair_avx2(d1, nd1, nmd1);
+            normal_cdf_pair_avx2(d2, nd2, nmd2);
+            __m256d callPrice = _mm256_fmsub_pd(s, nd1, _mm256_mul_pd(kdf, nd2));
+            __m256d putPrice = _mm256_fmsub_pd(kdf, nmd2, _mm256_mul_pd(s, nmd1));
+            __m256d diff = _mm256_sub_pd(_mm256_blendv_pd(callPrice, putPrice, usePut), target);
+            hi = _mm256_blendv_pd(hi, v, _mm256_cmp_pd(diff, zero, _CMP_GT_OQ));
+            lo = _mm256_blendv_pd(lo, v, _mm256_cmp_pd(diff, zero, _CMP_LT_OQ));
+            __m256d pdf = _mm256_div_pd(exp_avx2(_mm256_mul_pd(_mm256_mul_pd(d1, d1), _mm256_set1_pd(-0.5))), _mm256_set1_pd(SIMD_SQRT_2PI));
+            __m256d newton = _mm256_div_pd(diff, _mm256_mul_pd(_mm256_mul_pd(s, sqrtT), pdf));
+            __m256d damping = _mm256_fnmadd_pd(_mm256_mul_pd(half, newton), _mm256_div_pd(_mm256_mul_pd(d1, d2), v), one);
+            __m256d next = _mm256_sub_pd(v, _mm256_div_pd(newton, damping));
+            __m256d inside = _mm256_and_pd(_mm256_cmp_pd(next, lo, _CMP_GE_OQ), _mm256_cmp_pd(next, hi, _CMP_LE_OQ));
+            next = _mm256_blendv_pd(_mm256_mul_pd(half, _mm256_add_pd(lo, hi)), next, inside);
+            __m256d converged = _mm256_cmp_pd(_mm256_and_pd(absMask, _mm256_sub_pd(next, v)), _mm256_set1_pd(IV_TOLERANCE), _CMP_LT_OQ);
+            v = _mm256_blendv_pd(next, v, done);// lanes that are already done keep their vol
+            done = _mm256_or_pd(done, converged);
+        }
+        _mm256_storeu_pd(vol + i, _mm256_blendv_pd(_mm256_set1_pd(NAN), v, valid));
+    }
+    return i;
+}
+
+#pragma GCC pop_options
+
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"// GCC 12 false positive inside the avx512f set1 intrinsics
+
+static inline __m512d exp_avx512(__m512d x) {
+    const __m512d magic = _mm512_set1_pd(SIMD_ROUND_MAGIC);
+    x = _mm512_max_pd(_mm512_min_pd(x, _mm512_set1_pd(SIMD_EXP_MAX)), _mm512_set1_pd(SIMD_EXP_MIN));
+    __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(SIMD_LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d rem = _mm512_fnmadd_pd(n, _mm512_set1_pd(SIMD_LN2_HI), x);
+    rem = _mm512_fnmadd_pd(n, _mm512_set1_pd(SIMD_LN2_LO), rem);
+    __m512d p = _mm512_set1_pd(SIMD_EXP_POLY[12]);
+    for (int k = 11; k >= 0; --k) p = _mm512_fmadd_pd(p, rem, _mm512_set1_pd(SIMD_EXP_POLY[k]));
+    __m512i ni = _mm512_sub_epi64(_mm512_castpd_si512(_mm512_add_pd(n, magic)), _mm512_castpd_si512(magic));
+    __m512d scale = _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_add_epi64(ni, _mm512_set1_epi64(1023)), 52));
+    return _mm512_mul_pd(p, scale);
+}
+
+static inline __m512d log_avx512(__m512d x) {// x must be positive and normal
+    const __m512d magic = _mm512_set1_pd(SIMD_ROUND_MAGIC);
+    __m512i bits = _mm512_castpd_si512(x);
+    __m512d m = _mm512_castsi512_pd(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi64(0x000FFFFFFFFFFFFFLL)),
+                                                    _mm512_set1_epi64(0x3FF0000000000000LL)));
+    __m512i e = _mm512_srli_epi64(bits, 52);
+    __m512d ed = _mm512_sub_pd(_mm512_castsi512_pd(_mm512_add_epi64(e, _mm512_castpd_si512(magic))), magic);
+    ed = _mm512_sub_pd(ed, _mm512_set1_pd(1023.0));
+    __mmask8 high = _mm512_cmp_pd_mask(m, _mm512_set1_pd(M_SQRT2), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, high, m, _mm512_set1_pd(0.5));
+    ed = _mm512_mask_add_pd(ed, high, ed, _mm512_set1_pd(1.0));
+    __m512d s = _mm512_div_pd(_mm512_sub_pd(m, _mm512_set1_pd(1.0)), _mm512_add_pd(m, _mm512_set1_pd(1.0)));
+    __m512d z = _mm512_mul_pd(s, s);
+    __m512d p = _mm512_set1_pd(1.0 / 21);
+    for (int k = 9; k >= 0; --k) p = _mm512_fmadd_pd(p, z, _mm512_set1_pd(1.0 / (2 * k + 1)));
+    __m512d logm = _mm512_mul_pd(_mm512_add_pd(s, s), p);
+    return _mm512_fmadd_pd(ed, _mm512_set1_pd(SIMD_LN2), logm);
+}
+
+static inline void normal_cdf_pair_avx512(__m512d x, __m512d& cdf, __m512d& cdfNeg) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    __m512d a = _mm512_abs_pd(x);
+    __m512d e = exp_avx512(_mm512_mul_pd(_mm512_mul_pd(a, a), _mm512_set1_pd(-0.5)));
+    __m512d num = _mm512_set1_pd(SIMD_CDF_NUM[0]);
+    for (int k = 1; k < 7; ++k) num = _mm512_fmadd_pd(num, a, _mm512_set1_pd(SIMD_CDF_NUM[k]));
+    __m512d den = _mm512_set1_pd(SIMD_CDF_DEN[0]);
+    for (int k = 1; k < 8; ++k) den = _mm512_fmadd_pd(den, a, _mm512_set1_pd(SIMD_CDF_DEN[k]));
+    __m512d body = _mm512_div_pd(_mm512_mul_pd(e, num), den);
+    __m512d b = _mm512_add_pd(a, _mm512_set1_pd(0.65));
+    for (int k = 4; k >= 1; --k) b = _mm512_add_pd(a, _mm512_div_pd(_mm512_set1_pd(k), b));
+    __m512d tail = _mm512_div_pd(e, _mm512_mul_pd(b, _mm512_set1_pd(SIMD_SQRT_2PI)));
+    __m512d c = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, _mm512_set1_pd(SIMD_CDF_SPLIT), _CMP_GE_OQ), body, tail);
+    c = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, _mm512_set1_pd(SIMD_CDF_CUTOFF), _CMP_GT_OQ), c, _mm512_setzero_pd());
+    __m512d upper = _mm512_sub_pd(one, c);
+    cdf = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_GT_OQ), c, upper);
+    cdfNeg = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_LT_OQ), c, upper);
+}
+
+static inline void bs_terms_avx512(__m512d s, __m512d k, __m512d t, __m512d rate, __m512d vol,
+                                   __m512d& d1, __m512d& d2, __m512d& volT, __m512d& kdf) {
+    volT = _mm512_mul_pd(vol, _mm512_sqrt_pd(t));
+    __m512d drift = _mm512_fmadd_pd(_mm512_mul_pd(vol, vol), _mm512_set1_pd(0.5), rate);
+    d1 = _mm512_div_pd(_mm512_fmadd_pd(drift, t, log_avx512(_mm512_div_pd(s, k))), volT);
+    d2 = _mm512_sub_pd(d1, volT);
+    kdf = _mm512_mul_pd(k, exp_avx512(_mm512_mul_pd(_mm512_sub_pd(_mm512_setzero_pd(), rate), t)));
+}
+
+static size_t price_options_avx512(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                                   double* calls, double* puts, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d s = _mm512_loadu_pd(S + i), k = _mm512_loadu_pd(K + i), t = _mm512_loadu_pd(T + i);
+        __m512d rate = _mm512_loadu_pd(r + i), vol = _mm512_loadu_pd(sigma + i);
+        __m512d d1, d2, volT, kdf;
+        bs_terms_avx512(s, k, t, rate, vol, d1, d2, volT, kdf);
+        __m512d nd1, nmd1, nd2, nmd2;
+        normal_cdf_pair_avx512(d1, nd1, nmd1);
+        normal_cdf_pair_avx512(d2, nd2, nmd2);
+        __m512d call = _mm512_fmsub_pd(s, nd1, _mm512_mul_pd(kdf, nd2));
+        __m512d put = _mm512_fmsub_pd(kdf, nmd2, _mm512_mul_pd(s, nmd1));
+        __mmask8 zeroVol = _mm512_cmp_pd_mask(vol, _mm512_setzero_pd(), _CMP_EQ_OQ);
+        call = _mm512_mask_blend_pd(zeroVol, call, _mm512_max_pd(_mm512_setzero_pd(), _mm512_sub_pd(s, k)));
+        put = _mm512_mask_blend_pd(zeroVol, put, _mm512_max_pd(_mm512_setzero_pd(), _mm512_sub_pd(k, s)));
+        _mm512_storeu_pd(calls + i, call);
+        _mm512_storeu_pd(puts + i, put);
+    }
+    return i;
+}
+
+static size_t option_greeks_avx512(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                                   const uint8_t* isCall, OptionGreeksOut out, size_t n) {
+    const __m512d zero = _mm512_setzero_pd(), one = _mm512_set1_pd(1.0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d s = _mm512_loadu_pd(S + i), k = _mm512_loadu_pd(K + i), t = _mm512_loadu_pd(T + i);
+        __m512d rate = _mm512_loadu_pd(r + i), vol = _mm512_loadu_pd(sigma + i);
+        __m512d d1, d2, volT, kdf;
+        bs_terms_avx512(s, k, t, rate, vol, d1, d2, volT, kdf);
+        __m512d nd1, nmd1, nd2, nmd2;
+        normal_cdf_pair_avx512(d1, nd1, nmd1);
+        normal_cdf_pair_avx512(d2, nd2, nmd2);
+        __m512d pdf = _mm512_div_pd(exp_avx512(_mm512_mul_pd(_mm512_mul_pd(d1, d1), _mm512_set1_pd(-0.5))), _mm512_set1_pd(SIMD_SQRT_2PI));
+        __mmask8 call = 0;
+        for (int lane = 0; lane < 8; ++lane) call |= __mmask8((isCall[i + lane] != 0) << lane);
+        __m512d sPdf = _mm512_mul_pd(s, pdf);
+        __m512d decay = _mm512_div_pd(_mm512_mul_pd(sPdf, vol), _mm512_mul_pd(_mm512_set1_pd(-2.0), _mm512_sqrt_pd(t)));
+        __m512d rkdf = _mm512_mul_pd(rate, kdf), tkdf = _mm512_mul_pd(t, kdf);
+        __m512d value = _mm512_mask_blend_pd(call, _mm512_fmsub_pd(kdf, nmd2, _mm512_mul_pd(s, nmd1)), _mm512_fmsub_pd(s, nd1, _mm512_mul_pd(kdf, nd2)));
+        __m512d delta = _mm512_mask_blend_pd(call, _mm512_sub_pd(nd1, one), nd1);
+        __m512d gamma = _mm512_div_pd(pdf, _mm512_mul_pd(s, volT));
+        __m512d vega = _mm512_mul_pd(sPdf, _mm512_sqrt_pd(t));
+        __m512d theta = _mm512_mask_blend_pd(call, _mm512_fmadd_pd(rkdf, nmd2, decay), _mm512_fnmadd_pd(rkdf, nd2, decay));
+        __m512d rho = _mm512_mask_blend_pd(call, _mm512_sub_pd(zero, _mm512_mul_pd(tkdf, nmd2)), _mm512_mul_pd(tkdf, nd2));
+        __mmask8 degenerate = _mm512_cmp_pd_mask(volT, zero, _CMP_EQ_OQ) | _mm512_cmp_pd_mask(t, zero, _CMP_LE_OQ);
+        __m512d intrinsic = _mm512_mask_blend_pd(call, _mm512_sub_pd(k, s), _mm512_sub_pd(s, k));
+        __mmask8 inMoney = _mm512_cmp_pd_mask(intrinsic, zero, _CMP_GT_OQ);
+        value = _mm512_mask_blend_pd(degenerate, value, _mm512_max_pd(zero, intrinsic));
+        __m512d intrinsicDelta = _mm512_maskz_mov_pd(inMoney, _mm512_mask_blend_pd(call, _mm512_set1_pd(-1.0), one));
+        delta = _mm512_mask_blend_pd(degenerate, delta, intrinsicDelta);
+        gamma = _mm512_mask_blend_pd(degenerate, gamma, zero);
+        vega = _mm512_mask_blend_pd(degenerate, vega, zero);
+        theta = _mm512_mask_blend_pd(degenerate, theta, zero);
+        rho = _mm512_mask_blend_pd(degenerate, rho, zero);
+        _mm512_storeu_pd(out.value + i, value);
+        _mm512_storeu_pd(out.delta + i, delta);
+        _mm512_storeu_pd(out.gamma + i, gamma);
+        _mm512_storeu_pd(out.vega + i, vega);
+        _mm512_storeu_pd(out.theta + i, theta);
+        _mm512_storeu_pd(out.rho + i, rho);
+    }
+    return i;
+}
+
+static size_t implied_vol_avx512(const double* premium, const double* S, const double* K, const double* T, const double* r,
+                                 const uint8_t* isCall, double* vol, size_t n) {
+    const __m512d zero = _mm512_setzero_pd(), half = _mm512_set1_pd(0.5), one = _mm512_set1_pd(1.0);
+    const __m512d minVol = _mm512_set1_pd(IV_MIN_VOL), maxVol = _mm512_set1_pd(IV_MAX_VOL);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512d s = _mm512_loadu_pd(S + i), t = _mm512_loadu_pd(T + i), price = _mm512_loadu_pd(premium + i);
+        __m512d kdf = _mm512_mul_pd(_mm512_loadu_pd(K + i), exp_avx512(_mm512_mul_pd(_mm512_sub_pd(zero, _mm512_loadu_pd(r + i)), t)));
+        __mmask8 call = 0;
+        for (int lane = 0; lane < 8; ++lane) call |= __mmask8((isCall[i + lane] != 0) << lane);
+        __m512d forwardGap = _mm512_sub_pd(s, kdf);
+        __mmask8 usePut = _mm512_cmp_pd_mask(forwardGap, zero, _CMP_GT_OQ);
+        __m512d parity = _mm512_mask_blend_pd(call, _mm512_maskz_mov_pd(__mmask8(~usePut), forwardGap),
+                                              _mm512_maskz_mov_pd(usePut, _mm512_sub_pd(zero, forwardGap)));
+        __m512d target = _mm512_add_pd(price, parity);
+        __mmask8 valid = _mm512_cmp_pd_mask(t, zero, _CMP_GT_OQ) & _mm512_cmp_pd_mask(target, zero, _CMP_GT_OQ) &
+                         _mm512_cmp_pd_mask(target, _mm512_mask_blend_pd(usePut, s, kdf), _CMP_LT_OQ);
+        __m512d sqrtT = _mm512_sqrt_pd(t), logMoneyness = log_avx512(_mm512_div_pd(s, kdf));
+        __m512d centre = _mm512_fnmadd_pd(half, forwardGap, _mm512_add_pd(target, _mm512_maskz_mov_pd(usePut, forwardGap)));
+        __m512d disc = _mm512_max_pd(zero, _mm512_fnmadd_pd(_mm512_mul_pd(forwardGap, forwardGap), _mm512_set1_pd(1 / M_PI),
+                                                            _mm512_mul_pd(centre, centre)));
+        __m512d guess = _mm512_mul_pd(_mm512_div_pd(_mm512_sqrt_pd(_mm512_div_pd(_mm512_set1_pd(2 * M_PI), t)), _mm512_add_pd(s, kdf)),
+                                      _mm512_add_pd(centre, _mm512_sqrt_pd(disc)));
+        __m512d v = _mm512_min_pd(maxVol, _mm512_max_pd(minVol, guess));
+        __m512d lo = minVol, hi = maxVol;
+        __mmask8 done = __mmask8(~valid);
+        for (int it = 0; it < IV_MAX_ITERATIONS && done != 0xFF; ++it) {
+            __m512d volT = _mm512_mul_pd(v, sqrtT);
+            __m512d d1 = _mm512_fmadd_pd(half, volT, _mm512_div_pd(logMoneyness, volT));
+            __m512d d2 = _mm512_sub_pd(d1, volT);
+            __m512d nd1, nmd1, nd2, nmd2;
+            normal_cdf_pair_avx512(d1, nd1, nmd1);
+            normal_cdf_pair_avx512(d2, nd2, nmd2);
+            __m512d callPrice = _mm512_fmsub_pd(s, nd1, _mm512_mul_pd(kdf, nd2));
+            __m512d putPrice = _mm512_fmsub_pd(kdf, nmd2, _mm512_mul_pd(s, nmd1));
+            __m512d diff = _mm512_sub_pd(_mm512_mask_blend_pd(usePut, callPrice, putPrice), target);
+            hi = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(diff, zero, _CMP_GT_OQ), hi, v);
+            lo = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(diff, zero, _CMP_LT_OQ), lo, v);
+            __m512d pdf = _mm512_div_pd(exp_avx512(_mm512_mul_pd(_mm512_mul_pd(d1, d1), _mm512_set1_pd(-0.5))), _mm512_set1_pd(SIMD_SQRT_2PI));
+            __m512d newton = _mm512_div_pd(diff, _mm512_mul_pd(_mm512_mul_pd(s, sqrtT), pdf));
+            __m512d damping = _mm512_fnmadd_pd(_mm512_mul_pd(half, newton), _mm512_div_pd(_mm512_mul_pd(d1, d2), v), one);
+            __m512d next = _mm512_sub_pd(v, _mm512_div_pd(newton, damping));
+            __mmask8 inside = _mm512_cmp_pd_mask(next, lo, _CMP_GE_OQ) & _mm512_cmp_pd_mask(next, hi, _CMP_LE_OQ);
+            next = _mm512_mask_blend_pd(inside, _mm512_mul_pd(half, _mm512_add_pd(lo, hi)), next);
+            __mmask8 converged = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(next, v)), _mm512_set1_pd(IV_TOLERANCE), _CMP_LT_OQ);
+            v = _mm512_mask_blend_pd(done, next, v);
+            done |= converged;
+        }
+        _mm512_storeu_pd(vol + i, _mm512_mask_blend_pd(valid, _mm512_set1_pd(NAN), v));
+    }
+    return i;
+}
+
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+// Greeks for n contracts, laid out like price_options_batch plus a call flag per contract. The kernels
+// share d1/d2 and the discounted strike with the pricer's kernels.
+void option_greeks_batch(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                         const uint8_t* isCall, OptionGreeksOut out, size_t n, PricerMode mode = PricerMode::Auto) {
+    size_t done = 0;
+    switch (resolve_pricer_mode(mode)) {
+#if HAVE_X86_SIMD
+        case PricerMode::AVX512: done = option_greeks_avx512(S, K, T, r, sigma, isCall, out, n); break;
+        case PricerMode::AVX2: done = option_greeks_avx2(S, K, T, r, sigma, isCall, out, n); break;
+#endif
+        default: break;
+    }
+    for (size_t i = done; i < n; ++i) {
+        Greeks g = option_greeks(S[i], K[i], T[i], r[i], sigma[i], isCall[i]);
+        out.value[i] = g.value;
+        out.delta[i] = g.delta;
+        out.gamma[i] = g.gamma;
+        out.vega[i] = g.vega;
+        out.theta[i] = g.theta;
+        out.rho[i] = g.rho;
+    }
+}
+
+// Implied vols of n quoted premiums, laid out like option_greeks_batch. Quotes outside the no-arbitrage
+// range come back as NaN.
+void implied_vol_batch(const double* premium, const double* S, const double* K, const double* T, const double* r,
+                       const uint8_t* isCall, double* vol, size_t n, PricerMode mode = PricerMode::Auto) {
+    size_t done = 0;
+    switch (resolve_pricer_mode(mode)) {
+#if HAVE_X86_SIMD
+        case PricerMode::AVX512: done = implied_vol_avx512(premium, S, K, T, r, isCall, vol, n); break;
+        case PricerMode::AVX2: done = implied_vol_avx2(premium, S, K, T, r, isCall, vol, n); break;
+#endif
+        default: break;
+    }
+    for (size_t i = done; i < n; ++i) vol[i] = implied_vol(premium[i], S[i], K[i], T[i], r[i], isCall[i]);
+}
+
+// Prices n contracts; the arrays are parallel (one contract per index). The SIMD kernels handle full
+// vectors and the remainder goes through the scalar reference.
+void price_options_batch(const double* S, const double* K, const double* T, const double* r, const double* sigma,
+                         double* calls, double* puts, size_t n, PricerMode mode = PricerMode::Auto) {
+    size_t done = 0;
+    switch (resolve_pricer_mode(mode)) {
+#if HAVE_X86_SIMD
+        case PricerMode::AVX512: done = price_options_avx512(S, K, T, r, sigma, calls, puts, n); break;
+        case PricerMode::AVX2: done = price_options_avx2(S, K, T, r, sigma, calls, puts, n); break;
+#endif
+        default: break;
+    }
+    price_options_scalar(S, K, T, r, sigma, calls, puts, done, n);
+}
+
+// ---- Day-scoped memory ----
+// Global operator new counts allocations per thread, so alloc-check can show the tick path stays off the
+// heap once warm; everywhere else it costs one thread-local increment per allocation.
+thread_local uint64_t heapAllocations = 0;
+
+// Out of line, so GCC does not pair an inlined free() with the new-expression at the call site.
+__attribute__((noinline)) void* operator new(size_t size) {
+    ++heapAllocations;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+const size_t DAY_ARENA_CHUNK = size_t(1) << 20;
+
+// Bump allocator for what a trading day builds up (the option inventories). Deallocation is a no-op and
+// reset() rewinds to the start in O(1). A day that spilled past the first chunk has its chunks replaced at
+// reset by one with twice the busiest day's usage, so the days after it are served from memory the arena
+// already owns. Whatever lives in it must be dropped before reset().
+class DayArena : public pmr::memory_resource {
+    struct Chunk {
+        char* base;
+        size_t size;
+    };
+    vector<Chunk> chunks;
+    size_t active = 0;// chunk being carved
+    size_t offset = 0;
+    size_t dayBytes = 0;// handed out since the last reset
+    size_t peakDayBytes = 0;
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        for (;; ++active, offset = 0) {
+            if (active == chunks.size()) {
+                size_t size = max(DAY_ARENA_CHUNK, bytes + alignment);
+                chunks.push_back({static_cast<char*>(::operator new(size)), size});
+            }
+            Chunk& chunk = chunks[active];
+            uintptr_t base = reinterpret_cast<uintptr_t>(chunk.base);
+            uintptr_t start = (base + offset + alignment - 1) & ~uintptr_t(alignment - 1);
+            if (start + bytes <= base + chunk.size) {// a chunk too small for a large request is skipped for the day
+                offset = start + bytes - base;
+                dayBytes += bytes;
+                return reinterpret_cast<void*>(start);
+            }
+        }
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+    DayArena() = default;
+    DayArena(const DayArena&) = delete;
+    DayArena& operator=(const DayArena&) = delete;
+    ~DayArena() override {
+        for (Chunk& chunk : chunks) ::operator delete(chunk.base);
+    }
+
+    void reset() {
+        peakDayBytes = max(peakDayBytes, dayBytes);
+        if (chunks.size() > 1) {
+            size_t size = max(DAY_ARENA_CHUNK, 2 * peakDayBytes);
+            for (Chunk& chunk : chunks) ::operator delete(chunk.base);
+            chunks.assign(1, {static_cast<char*>(::operator new(size)), size});
+        }
+        active = 0;
+        offset = 0;
+        dayBytes = 0;
+    }
+
+    size_t reserved_bytes() const {
+        size_t total = 0;
+        for (const Chunk& chunk : chunks) total += chunk.size;
+        return total;
+    }
+};
+
+// ---- Fixed-point money ----
+// Cash, cost basis, limit prices and settlement amounts are whole micro-dollars in an int64, so thousands
+// of fills add up exactly and the balance never drifts. Doubles stay in market data and the pricing models;
+// an amount enters through from_dollars, which rounds to the nearest micro-dollar. Arithmetic that would
+// wrap throws instead.
+const int64_t MONEY_UNITS_PER_DOLLAR = 1000000;
+const double MONEY_MAX_DOLLARS = 9.0e12;// int64 micro-dollars run out just past 9.2e12
+
+struct Money {
+    int64_t micros = 0;
+
+    static Money from_micros(int64_t units) { return Money{units}; }
+    static Money from_dollars(double dollars) {// no libm call, so it stays cheap on the tick path
+        if (!(fabs(dollars) < MONEY_MAX_DOLLARS)) throw runtime_error("amount outside the fixed-point range");
+        return Money{int64_t(dollars * MONEY_UNITS_PER_DOLLAR + copysign(0.5, dollars))};
+    }
+    double dollars() const { return double(micros) / MONEY_UNITS_PER_DOLLAR; }
+
+    Money operator+(Money other) const {
+        Money sum;
+        if (__builtin_add_overflow(micros, other.micros, &sum.micros)) throw runtime_error("money overflow");
+        return sum;
+    }
+    Money operator-(Money other) const {
+        Money difference;
+        if (__builtin_sub_overflow(micros, other.micros, &difference.micros)) throw runtime_error("money overflow");
+        return difference;
+    }
+    Money operator*(int64_t qty) const {
+        Money product;
+        if (__builtin_mul_overflow(micros, qty, &product.micros)) throw runtime_error("money overflow");
+        return product;
+    }
+    Money& operator+=(Money other) { return *this = *this + other; }
+    Money& operator-=(Money other) { return *this = *this - other; }
+
+    // Per-share amount of a total, rounded half away from zero; qty > 0.
+    Money per(int64_t qty) const {
+        int64_t half = qty / 2;
+        return Money{(micros >= 0 ? micros + half : micros - half) / qty};
+    }
+
+    bool operator==(Money other) const { return micros == other.micros; }
+    bool operator!=(Money other) const { return micros != other.micros; }
+    bool operator<(Money other) const { return micros < other.micros; }
+    bool operator<=(Money other) const { return micros <= other.micros; }
+    bool operator>(Money other) const { return micros > other.micros; }
+    bool operator>=(Money other) const { return micros >= other.micros; }
+};
+
+// Share counts are int64. A sizing rule's fractional count enters through here, truncated; a count past the
+// int64 range throws like Money does, since the cost of it could not be booked either.
+const double MAX_SHARE_COUNT = 9.0e18;
+
+inline int64_t checked_quantity(double count) {
+    if (!(count < MAX_SHARE_COUNT)) throw runtime_error("money overflow");
+    return count > 0 ? int64_t(count) : 0;
 }
 
 struct OptionContract {
     double strike;
     double premium;
-    double timeToMaturity;
+    double timeToMaturity;// at purchase
     bool isCall; // true for call, false for put
+    int boughtTick;
+    uint32_t markSlot = 0;// its entry in the OptionsBook, while option marking is on
+};
+
+// Held options ordered by what exercises them: calls in a min-heap on strike, puts in a max-heap, so the
+// exit sweep pops exactly the contracts the price has crossed and never copies the rest. The heaps draw
+// from the memory resource they are given, the engine's DayArena.
+class OptionInventory {
+    pmr::vector<OptionContract> calls, puts;
+
+    static bool call_later(const OptionContract& a, const OptionContract& b) { return a.strike > b.strike; }
+    static bool put_later(const OptionContract& a, const OptionContract& b) { return a.strike < b.strike; }
+
+public:
+    explicit OptionInventory(pmr::memory_resource* memory = pmr::get_default_resource()) : calls(memory), puts(memory) {}
+
+    void add(const OptionContract& opt) {
+        if (opt.isCall) {
+            calls.push_back(opt);
+            push_heap(calls.begin(), calls.end(), call_later);
+        } else {
+            puts.push_back(opt);
+            push_heap(puts.begin(), puts.end(), put_later);
+        }
+    }
+
+    // Removes every call struck below price and every put struck above it, calls first, each side in
+    // the order the price crossed them, and hands each one to onExercise.
+    template <typename OnExercise>
+    void exercise(double price, OnExercise&& onExercise) {
+        while (!calls.empty() && price > calls.front().strike) {
+            pop_heap(calls.begin(), calls.end(), call_later);
+            onExercise(calls.back());
+            calls.pop_back();
+        }
+        while (!puts.empty() && price < puts.front().strike) {
+            pop_heap(puts.begin(), puts.end(), put_later);
+            onExercise(puts.back());
+            puts.pop_back();
+        }
+    }
+
+    // Exercise triggers for the signal pass: the sweep has work only if price > call_trigger() or
+    // price < put_trigger().
+    double call_trigger() const { return calls.empty() ? INFINITY : calls.front().strike; }
+    double put_trigger() const { return puts.empty() ? -INFINITY : puts.front().strike; }
+
+    template <typename Visit>
+    void for_each(Visit&& visit) const {
+        for (const auto& opt : calls) visit(opt);
+        for (const auto& opt : puts) visit(opt);
+    }
+
+    template <typename Visit>
+    void for_each(Visit&& visit) {// visit may change anything but the strike, which orders the heaps
+        for (auto& opt : calls) visit(opt);
+        for (auto& opt : puts) visit(opt);
+    }
+
+    size_t size() const { return calls.size() + puts.size(); }
+    bool empty() const { return calls.empty() && puts.empty(); }
+    void clear() {
+        calls.clear();
+        puts.clear();
+    }
+
+    // Empties the heaps and gives their storage back, ahead of a DayArena reset.
+    void release() {
+        calls = pmr::vector<OptionContract>(calls.get_allocator());
+        puts = pmr::vector<OptionContract>(puts.get_allocator());
+    }
 };
 
-struct Position {//Stores information about owned stocks and associated options per company.
+struct Position {//Stores the company name and the options held per company; shares and avgPrice live in UniverseState.
     string company;
-    int shares = 0;
-    double avgPrice = 0.0;
     double optionPayout = 0.0;
-    vector<OptionContract> optionsHeld;
+    OptionInventory optionsHeld;
+
+    explicit Position(pmr::memory_resource* memory) : optionsHeld(memory) {}
 };
 
-class TradingEngine {
-    map<string, deque<double>> history;//for storing the history of companies for calculating SMA
-    map<string, Position> portfolio;// how many positions are held of which companies in the portfolio
-    double balance;
+using SymbolId = uint32_t;
+const SymbolId INVALID_SYMBOL = UINT32_MAX;
+
+// intern() and find() belong to the owning (trading) thread; other threads that read names while
+// new tickers may still be interned, such as the log writer, hold names_lock() around their reads.
+class SymbolRegistry {//interns tickers once at startup and hands out dense ids used to index flat per-symbol arrays
+    deque<string> names;// deque never relocates elements, so the string_view keys below stay valid
+    unordered_map<string_view, SymbolId> ids;
+    mutable shared_mutex namesMutex;
 
 public:
-    TradingEngine(double startBalance) : balance(startBalance) {
-        cout << fixed << setprecision(2);
-        cout << "Initial Balance: $" << balance << endl;
+    SymbolId intern(string_view name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        unique_lock<shared_mutex> lock(namesMutex);
+        names.emplace_back(name);
+        SymbolId id = SymbolId(names.size() - 1);
+        ids.emplace(names.back(), id);
+        return id;
     }
 
-    void update_price(const string& company, double price, int tick) {
-        auto& hist = history[company];
-        hist.push_back(price);
-        if (hist.size() > SMA_WINDOW) hist.pop_front();
+    SymbolId find(string_view name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? INVALID_SYMBOL : it->second;
+    }
 
-        if (hist.size() == SMA_WINDOW) {
-            double sma = accumulate(hist.begin(), hist.end(), 0.0) / SMA_WINDOW;
-            double limitBuy = price * (1.0 - LIMIT_SLIPPAGE);//you place a buy order only if it’s ≤ limitBuy
-            double limitSell = price * (1.0 + LIMIT_SLIPPAGE);
+    const string& name(SymbolId id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+    shared_lock<shared_mutex> names_lock() const { return shared_lock<shared_mutex>(namesMutex); }
+};
 
-            if (price < sma && balance >= limitBuy) {
-                int qty = int(balance / limitBuy / COMPANIES);// how many shares we can buy is qty
-                if (qty > 0) {
-                    balance -= qty * limitBuy;
-                    auto& pos = portfolio[company];
-                    pos.avgPrice = (pos.avgPrice * pos.shares + limitBuy * qty) / (pos.shares + qty);
-                    pos.shares += qty;
-                    cout << "BUY " << qty << " shares of " << company << " at $" << limitBuy << endl;
-
-                    double strike = price * 1.05;//strike price for the call option to be 5% higher placing an OTM call
-                    double callPremium = call_price(price, strike, 0.1, 0.01, 0.2);
-                    if (balance >= callPremium) {
-                        balance -= callPremium;
-                        OptionContract opt = {strike, callPremium, 0.1};
-                        pos.optionsHeld.push_back(opt);
-                        cout << "BUY CALL OPTION on " << company << " strike: $" << strike << " premium: $" << callPremium << endl;
-                    }
-                    
-                    double putStrike = price * 0.95;
-                    double putPremium = put_price(price, putStrike, 0.1, 0.01, 0.2);
-                    if (balance >= putPremium) {
-                        balance -= putPremium;
-                        OptionContract opt = {putStrike, putPremium, 0.1, false};
-                        pos.optionsHeld.push_back(opt);
-                        cout << "BUY PUT OPTION on " << company << " strike: $" << putStrike << " premium: $" << putPremium << endl;
-                    }
-                }
-            }
+// ---- Asynchronous event log ----
+// The trading thread writes fixed-size binary EventRecords into a per-producer SPSC ring; a background
+// thread drains the rings, formats with to_chars and writes to the output in large batches.
 
-            auto& pos = portfolio[company];
-            if (price > sma && pos.shares > 0 && price > pos.avgPrice * 1.01) {
-                balance += pos.shares * limitSell;
-                cout << "SELL " << pos.shares << " shares of " << company << " at $" << limitSell << endl;
-                pos.shares = 0;
-                pos.avgPrice = 0;
-            }
+const size_t CACHE_LINE = 64;
 
-            if (tick % 2 == 0 && pos.shares > 0 && price < sma * 0.97) {//tick%2==0 runs every 10 min tick=5min
-                balance += pos.shares * price;
-                cout << "ALERT SELL " << pos.shares << " shares of " << company << " at $" << price << " due to drop forecast" << endl;
-                pos.shares = 0;
-                pos.avgPrice = 0;
-            }
+template <class T>
+class SpscRing {//single-producer/single-consumer ring; capacity is rounded up to a power of two
+    vector<T> slots;
+    size_t mask;
+    alignas(CACHE_LINE) atomic<size_t> head{0};// next slot to write, only the producer stores it
+    alignas(CACHE_LINE) atomic<size_t> tail{0};// next slot to read, only the consumer stores it
 
-            if (tick % 2 == 0) {
-                vector<OptionContract> remainingOptions;
-                for (auto& opt : pos.optionsHeld) {
-                    if ((opt.isCall && price > opt.strike) || (!opt.isCall && price < opt.strike)) {
-                        double payout = opt.isCall ? price - opt.strike : opt.strike - price;
-                        balance += payout;
-                        cout << "ALERT EXIT " << (opt.isCall ? "CALL" : "PUT") << " OPTION on " << company << " payout: $" << payout << endl;
-                    } else {
-                        remainingOptions.push_back(opt);
-                    }
-                }
-                pos.optionsHeld = remainingOptions;
-            }
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    bool try_push(const T& value) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h - tail.load(memory_order_acquire) == slots.size()) return false;
+        slots[h & mask] = value;
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t == head.load(memory_order_acquire)) return false;
+        out = slots[t & mask];
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    size_t pushed() const { return head.load(memory_order_acquire); }
+    size_t popped() const { return tail.load(memory_order_acquire); }
+};
+
+enum class EventType : uint8_t { Buy, BuyCall, BuyPut, Sell, AlertSell, AlertExitCall, AlertExitPut, EodSell, OptionPayout };
+
+struct EventRecord {// what the hot path writes; price/extra meaning depends on type (see format_event)
+    EventType type;
+    SymbolId symbol;
+    int64_t qty;
+    int32_t tick;
+    double price;
+    double extra;
+};
+
+enum class OverflowPolicy { Block, Drop };// Block spins until the writer catches up, Drop counts and discards
+
+const size_t LOG_RING_CAPACITY = 1 << 16;
+const size_t LOG_BATCH_BYTES = 1 << 16;
+
+class LogChannel {//one producer thread's end of the log
+    friend class AsyncLogger;
+    SpscRing<EventRecord> ring;
+    const SymbolRegistry* symbols;
+    OverflowPolicy policy;
+    atomic<uint64_t> written{0};// records the writer thread has handed to the output
+    atomic<uint64_t> dropped{0};
+    atomic<uint64_t> stalls{0};// pushes that found the ring full (backpressure)
+
+public:
+    LogChannel(const SymbolRegistry* registry, OverflowPolicy overflow)
+        : ring(LOG_RING_CAPACITY), symbols(registry), policy(overflow) {}
+
+    void log(const EventRecord& record) {
+        if (ring.try_push(record)) return;
+        stalls.fetch_add(1, memory_order_relaxed);
+        if (policy == OverflowPolicy::Drop) {
+            dropped.fetch_add(1, memory_order_relaxed);
+            return;
         }
+        while (!ring.try_push(record)) this_thread::yield();
     }
 
-    void end_of_day_settlement(map<string, double>& lastPrices) {
-        for (auto& [company, pos] : portfolio) {
-            if (pos.shares > 0) {
-                cout << "EOD SELL " << pos.shares << " shares of " << company << " at $" << lastPrices[company] << endl;
-                balance += pos.shares * lastPrices[company];
-                pos.shares = 0;
-                pos.avgPrice = 0;
-            }
-            for (auto& opt : pos.optionsHeld) {
-                if ((opt.isCall && lastPrices[company] > opt.strike) || (!opt.isCall && lastPrices[company] < opt.strike)) {
-                    double payout = opt.isCall ? lastPrices[company] - opt.strike : opt.strike - lastPrices[company];
-                    balance += payout;
-                    cout << "OPTION PAYOUT for " << company << " strike $" << opt.strike << ": $" << payout << endl;
+    uint64_t dropped_count() const { return dropped.load(memory_order_relaxed); }
+    uint64_t stall_count() const { return stalls.load(memory_order_relaxed); }
+};
+
+class AsyncLogger {
+    vector<unique_ptr<LogChannel>> channels;
+    mutex channelsMutex;// guards channel registration against the writer's scan
+    FILE* out;
+    atomic<bool> running{true};
+    thread writer;// declared last so it starts after the members it reads
+
+    static char* append(char* p, string_view text) {
+        memcpy(p, text.data(), text.size());
+        return p + text.size();
+    }
+
+    static char* append_number(char* p, int64_t value) {
+        return to_chars(p, p + 24, value).ptr;
+    }
+
+    static char* append_money(char* p, double value) {
+        return to_chars(p, p + 64, value, chars_format::fixed, 2).ptr;
+    }
+
+    static char* format_event(char* p, const EventRecord& e, const string& company) {
+        switch (e.type) {
+            case EventType::Buy:
+            case EventType::Sell:
+            case EventType::AlertSell:
+            case EventType::EodSell:
+                p = append(p, e.type == EventType::Buy ? "BUY " : e.type == EventType::Sell ? "SELL "
+                            : e.type == EventType::AlertSell ? "ALERT SELL " : "EOD SELL ");
+                p = append_number(p, e.qty);
+                p = append(p, " shares of ");
+                p = append(p, company);
+                p = append(p, " at $");
+                p = append_money(p, e.price);
+                if (e.type == EventType::AlertSell) p = append(p, " due to drop forecast");
+                break;
+            case EventType::BuyCall:
+            case EventType::BuyPut:
+                p = append(p, e.type == EventType::BuyCall ? "BUY CALL OPTION on " : "BUY PUT OPTION on ");
+                p = append(p, company);
+                p = append(p, " strike: $");
+                p = append_money(p, e.price);
+                p = append(p, " premium: $");
+                p = append_money(p, e.extra);
+                break;
+            case EventType::AlertExitCall:
+            case EventType::AlertExitPut:
+                p = append(p, e.type == EventType::AlertExitCall ? "ALERT EXIT CALL OPTION on " : "ALERT EXIT PUT OPTION on ");
+                p = append(p, company);
+                p = append(p, " payout: $");
+                p = append_money(p, e.price);
+                break;
+            case EventType::OptionPayout:
+                p = append(p, "OPTION PAYOUT for ");
+                p = append(p, company);
+                p = append(p, " strike $");
+                p = append_money(p, e.price);
+                p = append(p, ": $");
+                p = append_money(p, e.extra);
+                break;
+        }
+        *p++ = '\n';
+        return p;
+    }
+
+    // Channels are never removed, so a snapshot of the pointers stays valid after channelsMutex is
+    // released; registration only waits for the copy, not for the writes. Counts are published after
+    // the one fflush per drain, so flush() returns only once the records have reached the output.
+    // names_lock() is held only while formatting into the buffer and dropped around every fwrite, so
+    // intern() never waits on I/O. Registries belong to the engines, so owners stop the logger first.
+    bool drain_once(vector<char>& buffer, vector<pair<LogChannel*, uint64_t>>& drained) {
+        drained.clear();
+        {
+            lock_guard<mutex> lock(channelsMutex);
+            for (auto& channel : channels) drained.emplace_back(channel.get(), 0);
+        }
+        char* begin = buffer.data();
+        char* p = begin;
+        bool any = false;
+        for (auto& [channel, count] : drained) {
+            EventRecord e;
+            shared_lock<shared_mutex> namesLock;// taken on the first record, an idle channel never touches its registry
+            while (channel->ring.try_pop(e)) {
+                if (!namesLock.owns_lock()) namesLock = channel->symbols->names_lock();
+                const string& company = channel->symbols->name(e.symbol);// a deque element, stable across interns
+                if (size_t(begin + buffer.size() - p) < company.size() + 256) {
+                    namesLock.unlock();
+                    fwrite(begin, 1, p - begin, out);
+                    p = begin;
+                    namesLock.lock();
                 }
+                p = format_event(p, e, company);
+                ++count;
             }
-            pos.optionsHeld.clear();
+            if (count == 0) continue;
+            namesLock.unlock();
+            fwrite(begin, 1, p - begin, out);
+            p = begin;
+            any = true;
         }
+        if (!any) return false;
+        fflush(out);
+        for (auto& [channel, count] : drained) {
+            if (count) channel->written.fetch_add(count, memory_order_release);
+        }
+        return true;
     }
 
-    void print_summary(double initialBalance) const {
-        cout << fixed << setprecision(2);
-        cout << "Final Balance: $" << balance << endl;
-        double profitLoss = balance - initialBalance;
-        cout << (profitLoss >= 0 ? "Profit: $" : "Loss: $") << abs(profitLoss) << endl;
-        for (const auto& [company, pos] : portfolio) {
-            if (pos.shares > 0) {
-                cout << company << ": " << pos.shares << " shares held at avg $" << pos.avgPrice << endl;
+    void run() {
+        vector<char> buffer(LOG_BATCH_BYTES);
+        vector<pair<LogChannel*, uint64_t>> drained;
+        while (running.load(memory_order_acquire)) {
+            if (!drain_once(buffer, drained)) this_thread::sleep_for(chrono::microseconds(50));
+        }
+        while (drain_once(buffer, drained)) {}// producers are done, flush whatever is left
+    }
+
+public:
+    explicit AsyncLogger(FILE* output = stdout) : out(output), writer(&AsyncLogger::run, this) {}
+
+    ~AsyncLogger() { stop(); }
+
+    LogChannel* open_channel(const SymbolRegistry& symbols, OverflowPolicy policy = OverflowPolicy::Block) {
+        lock_guard<mutex> lock(channelsMutex);
+        channels.push_back(make_unique<LogChannel>(&symbols, policy));
+        return channels.back().get();
+    }
+
+    void flush() {// returns once every record logged before the call has been written out
+        vector<pair<LogChannel*, uint64_t>> targets;
+        {
+            lock_guard<mutex> lock(channelsMutex);
+            for (auto& channel : channels) targets.emplace_back(channel.get(), channel->ring.pushed());
+        }
+        for (auto& [channel, target] : targets) {
+            while (channel->written.load(memory_order_acquire) < target) this_thread::yield();
+        }
+    }
+
+    void stop() {// idempotent; drains every channel before the writer exits
+        if (!writer.joinable()) return;
+        running.store(false, memory_order_release);
+        writer.join();
+        for (auto& channel : channels) {
+            if (channel->dropped_count() || channel->stall_count()) {
+                fprintf(stderr, "event log: %llu dropped, %llu stalled pushes\n",
+                        (unsigned long long)channel->dropped_count(), (unsigned long long)channel->stall_count());
             }
         }
     }
 };
 
-int main() {
-    srand(time(0));
-    TradingEngine engine(INITIAL_BALANCE);
-    vector<string> companies = {"AAPL", "GOOGL", "AMZN", "MSFT", "TSLA"};
-    map<string, double> prices;
+// ---- Limit order book ----
+// Price-time priority book over a window of integer price levels. Each level is an intrusive
+// doubly-linked FIFO of orders drawn from a pool, so add, cancel and modify are O(1) and allocate only
+// when the window or the pool grows: both start small and double on demand, up to the book's limits.
+// A two-level bitmap of non-empty levels finds the next best bid/ask with one bit scan per word once a
+// level empties, instead of walking the level array.
 
-    for (int tick = 0; tick < TICKS_PER_DAY; ++tick) {
-        for (const string& company : companies) {
-            double priceChange = ((rand() % 201) - 100) / 1000.0;
-            if (prices.find(company) == prices.end()) {
-                prices[company] = 100 + rand() % 50;
-            }
-            prices[company] *= (1 + priceChange);
-            prices[company] = round(prices[company] * 100.0) / 100.0;
-            engine.update_price(company, prices[company], tick);
+enum class Side : uint8_t { Buy, Sell };
+
+using OrderId = uint64_t;// (generation << 32) | pool slot, stale ids fail lookup once the slot is reused
+const OrderId NO_ORDER = 0;
+const uint32_t BOOK_NIL = UINT32_MAX;
+const int64_t BOOK_TICKS_PER_DOLLAR = 100;// one level per cent
+const uint32_t BOOK_LEVELS = 1 << 16;// at most a $655 window centred on the first price seen
+const uint32_t BOOK_ORDER_CAPACITY = 1 << 14;
+const uint32_t BOOK_INITIAL_LEVELS = 1 << 10;
+const uint32_t BOOK_INITIAL_ORDERS = 1 << 8;
+
+inline int64_t to_book_ticks(double price) { return llround(price * BOOK_TICKS_PER_DOLLAR); }
+inline double from_book_ticks(int64_t ticks) { return double(ticks) / BOOK_TICKS_PER_DOLLAR; }
+static_assert(MONEY_UNITS_PER_DOLLAR % BOOK_TICKS_PER_DOLLAR == 0, "a book level must be a whole number of money units");
+const int64_t MONEY_UNITS_PER_BOOK_TICK = MONEY_UNITS_PER_DOLLAR / BOOK_TICKS_PER_DOLLAR;
+inline Money money_from_book_ticks(int64_t ticks) { return Money::from_micros(ticks) * MONEY_UNITS_PER_BOOK_TICK; }
+inline int64_t book_ticks_at_or_below(Money price) { return price.micros / MONEY_UNITS_PER_BOOK_TICK; }// prices are positive
+inline int64_t book_ticks_at_or_above(Money price) { return (price.micros + MONEY_UNITS_PER_BOOK_TICK - 1) / MONEY_UNITS_PER_BOOK_TICK; }
+
+struct Fill {
+    OrderId maker;
+    uint32_t makerOwner;
+    uint32_t takerOwner;
+    Side takerSide;
+    int64_t price;// book ticks, always the resting order's price
+    int64_t qty;
+};
+
+class OrderBook {
+    struct Order {
+        uint32_t prev, next;
+        uint32_t level;
+        uint32_t generation = 1;
+        int64_t qty = 0;// 0 when the slot is free
+        uint32_t owner;
+        Side side;
+    };
+
+    struct Level {
+        uint32_t head = BOOK_NIL, tail = BOOK_NIL;
+        int64_t qty = 0;
+    };
+
+    int64_t lowestPrice, highestPrice;// the window may grow to [lowestPrice, highestPrice)
+    uint32_t orderCapacity;
+    int64_t basePrice;// price of level 0
+    vector<Level> levels;
+    vector<Order> orders;
+    vector<uint32_t> freeSlots;
+    int64_t bestBid = -1;// level index, -1 without bids
+    int64_t bestAsk;// level index, levels.size() without asks
+    vector<uint64_t> occupied;// bit per level with resting orders; bids sit below asks, so one map serves both
+    vector<uint64_t> occupiedWords;// bit per nonzero word of occupied
+    vector<Fill> fillLog;
+    uint64_t rejected = 0;
+
+    static OrderId make_id(uint32_t slot, uint32_t generation) { return (uint64_t(generation) << 32) | slot; }
+
+    uint32_t slot_of(OrderId id) const {
+        uint32_t slot = uint32_t(id);
+        if (slot >= orders.size() || orders[slot].qty == 0 || orders[slot].generation != uint32_t(id >> 32)) return BOOK_NIL;
+        return slot;
+    }
+
+    void mark_level(uint32_t level, bool nonEmpty) {
+        uint32_t word = level >> 6;
+        if (nonEmpty) occupied[word] |= uint64_t(1) << (level & 63);
+        else occupied[word] &= ~(uint64_t(1) << (level & 63));
+        if (occupied[word]) occupiedWords[word >> 6] |= uint64_t(1) << (word & 63);
+        else occupiedWords[word >> 6] &= ~(uint64_t(1) << (word & 63));
+    }
+
+    int64_t highest_word_below(int64_t word) const {// highest nonzero word of occupied below word, or -1
+        if (word <= 0) return -1;
+        int64_t at = word - 1, group = at >> 6;
+        uint64_t bits = occupiedWords[group] & (~uint64_t(0) >> (63 - (at & 63)));
+        while (!bits) {
+            if (group == 0) return -1;
+            bits = occupiedWords[--group];
         }
+        return group * 64 + 63 - __builtin_clzll(bits);
     }
 
-    engine.end_of_day_settlement(prices);
-    engine.print_summary(INITIAL_BALANCE);
-    return 0;
-}
\ No newline at end of file
+    int64_t lowest_word_above(int64_t word) const {// lowest nonzero word of occupied above word, or -1
+        int64_t at = word + 1, group = at >> 6;
+        if (at >= int64_t(occupied.size())) return -1;
+        uint64_t bits = occupiedWords[group] & (~uint64_t(0) << (at & 63));
+        while (!bits) {
+            if (++group == int64_t(occupiedWords.size())) return -1;
+            bits = occupiedWords[group];
+        }
+        return group * 64 + __builtin_ctzll(bits);
+    }
+
+    int64_t highest_level_at_or_below(int64_t level) const {// -1 if none
+        if (level < 0) return -1;
+        int64_t word = level >> 6;
+        uint64_t bits = occupied[word] & (~uint64_t(0) >> (63 - (level & 63)));
+        if (!bits) {
+            word = highest_word_below(word);
+            if (word < 0) return -1;
+            bits = occupied[word];
+        }
+        return word * 64 + 63 - __builtin_clzll(bits);
+    }
+
+    int64_t lowest_level_at_or_above(int64_t level) const {// levels.size() if none
+        const int64_t none = int64_t(levels.size());
+        if (level >= none) return none;
+        int64_t word = level >> 6;
+        uint64_t bits = occupied[word] & (~uint64_t(0) << (level & 63));
+        if (!bits) {
+            word = lowest_word_above(word);
+            if (word < 0) return none;
+            bits = occupied[word];
+        }
+        return word * 64 + __builtin_ctzll(bits);
+    }
+
+    void link(uint32_t slot) {// append at the back of its level's FIFO
+        Order& order = orders[slot];
+        Level& level = levels[order.level];
+        order.prev = level.tail;
+        order.next = BOOK_NIL;
+        if (level.tail == BOOK_NIL) {
+            level.head = slot;
+            mark_level(order.level, true);
+        } else {
+            orders[level.tail].next = slot;
+        }
+        level.tail = slot;
+        level.qty += order.qty;
+        if (order.side == Side::Buy) bestBid = max<int64_t>(bestBid, order.level);
+        else bestAsk = min<int64_t>(bestAsk, order.level);
+    }
+
+    void unlink(uint32_t slot) {
+        Order& order = orders[slot];
+        Level& level = levels[order.level];
+        if (order.prev == BOOK_NIL) level.head = order.next;
+        else orders[order.prev].next = order.next;
+        if (order.next == BOOK_NIL) level.tail = order.prev;
+        else orders[order.next].prev = order.prev;
+        level.qty -= order.qty;
+        if (level.head == BOOK_NIL) {
+            mark_level(order.level, false);
+            if (bestBid == int64_t(order.level)) bestBid = highest_level_at_or_below(bestBid);
+            if (bestAsk == int64_t(order.level)) bestAsk = lowest_level_at_or_above(bestAsk);
+        }
+    }
+
+    void release(uint32_t slot) {
+        orders[slot].qty = 0;
+        ++orders[slot].generation;
+        freeSlots.push_back(slot);// reserved to the pool size
+    }
+
+    // New slots are handed out lowest first, the same order as a pool allocated whole.
+    bool grow_pool() {
+        uint32_t size = uint32_t(orders.size());
+        if (size == orderCapacity) return false;
+        uint32_t grown = min(orderCapacity, max(size * 2, BOOK_INITIAL_ORDERS));
+        orders.resize(grown);
+        freeSlots.reserve(grown);
+        for (uint32_t slot = grown; slot-- > size;) freeSlots.push_back(slot);
+        return true;
+    }
+
+    // Doubles the window towards [from, to] until it is covered, and shifts every level index by the growth
+    // below. Both ends must lie within the book's limits.
+    void grow_window(int64_t from, int64_t to) {
+        int64_t low = basePrice, high = basePrice + int64_t(levels.size());
+        while (from < low || to >= high) {
+            int64_t size = high - low;
+            if (from < low) low = max(lowestPrice, low - size);
+            else high = min(highestPrice, high + size);
+        }
+        const int64_t shift = basePrice - low;
+        const bool noAsks = bestAsk == int64_t(levels.size());
+        vector<Level> grown(size_t(high - low));
+        copy(levels.begin(), levels.end(), grown.begin() + shift);
+        levels.swap(grown);
+        for (Order& order : orders) {
+            if (order.qty) order.level += uint32_t(shift);
+        }
+        basePrice = low;
+        if (bestBid >= 0) bestBid += shift;
+        bestAsk = noAsks ? int64_t(levels.size()) : bestAsk + shift;
+        vector<uint64_t> old((levels.size() + 63) / 64);
+        old.swap(occupied);
+        occupiedWords.assign((occupied.size() + 63) / 64, 0);
+        for (size_t w = 0; w < old.size(); ++w) {
+            for (uint64_t bits = old[w]; bits; bits &= bits - 1) mark_level(uint32_t(w * 64 + __builtin_ctzll(bits) + shift), true);
+        }
+    }
+
+public:
+    OrderBook(double centerPrice, uint32_t levelCount = BOOK_LEVELS, uint32_t capacity = BOOK_ORDER_CAPACITY)
+        : lowestPrice(to_book_ticks(centerPrice) - levelCount / 2), highestPrice(lowestPrice + levelCount), orderCapacity(capacity) {
+        uint32_t window = min(levelCount, BOOK_INITIAL_LEVELS);
+        basePrice = lowestPrice + (levelCount - window) / 2;
+        levels.resize(window);
+        bestAsk = window;
+        occupied.resize((window + 63) / 64);
+        occupiedWords.resize((occupied.size() + 63) / 64);
+        orders.reserve(min(capacity, BOOK_INITIAL_ORDERS));
+        grow_pool();
+        fillLog.reserve(256);
+    }
+
+    // Grows the window ahead of time to cover [from, to], clamped to the book's limits, so that orders
+    // within that band do not allocate.
+    void reserve_prices(int64_t from, int64_t to) {
+        from = max(from, lowestPrice);
+        to = min(to, highestPrice - 1);
+        if (from <= to && (from < basePrice || to >= basePrice + int64_t(levels.size()))) grow_window(from, to);
+    }
+
+    // Matches against the opposite side at resting prices, then rests any remainder. Returns the resting
+    // order's id, or NO_ORDER when it filled completely or was rejected (price outside the window or pool full).
+    OrderId add(Side side, int64_t price, int64_t qty, uint32_t owner) {
+        if (qty <= 0 || price < lowestPrice || price >= highestPrice) {
+            ++rejected;
+            return NO_ORDER;
+        }
+        if (price < basePrice || price >= basePrice + int64_t(levels.size())) grow_window(price, price);
+        int64_t level = price - basePrice;
+        bool buy = side == Side::Buy;
+        while (qty > 0 && (buy ? bestAsk <= level : bestBid >= level)) {
+            uint32_t slot = levels[buy ? bestAsk : bestBid].head;
+            Order& maker = orders[slot];
+            int64_t traded = min(qty, maker.qty);
+            fillLog.push_back({make_id(slot, maker.generation), maker.owner, owner, side, basePrice + maker.level, traded});
+            qty -= traded;
+            maker.qty -= traded;
+            levels[maker.level].qty -= traded;
+            if (maker.qty == 0) {
+                unlink(slot);
+                release(slot);
+            }
+        }
+        if (qty == 0) return NO_ORDER;
+        if (freeSlots.empty() && !grow_pool()) {
+            ++rejected;
+            return NO_ORDER;
+        }
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        Order& order = orders[slot];
+        order.level = uint32_t(level);
+        order.qty = qty;
+        order.owner = owner;
+        order.side = side;
+        link(slot);
+        return make_id(slot, order.generation);
+    }
+
+    int64_t cancel(OrderId id) {// returns the quantity taken off the book, 0 if the order is gone
+        uint32_t slot = slot_of(id);
+        if (slot == BOOK_NIL) return 0;
+        int64_t qty = orders[slot].qty;
+        unlink(slot);
+        release(slot);
+        return qty;
+    }
+
+    // Reducing quantity keeps time priority; increasing it sends the order to the back of its level.
+    bool modify(OrderId id, int64_t newQty) {
+        uint32_t slot = slot_of(id);
+        if (slot == BOOK_NIL || newQty <= 0) return false;
+        Order& order = orders[slot];
+        if (newQty <= order.qty) {
+            levels[order.level].qty -= order.qty - newQty;
+            order.qty = newQty;
+            return true;
+        }
+        unlink(slot);
+        order.qty = newQty;
+        link(slot);
+        return true;
+    }
+
+    int64_t remaining(OrderId id) const {
+        uint32_t slot = slot_of(id);
+        return slot == BOOK_NIL ? 0 : orders[slot].qty;
+    }
+
+    int64_t best_bid() const { return bestBid < 0 ? -1 : basePrice + bestBid; }
+    int64_t best_ask() const { return bestAsk >= int64_t(levels.size()) ? -1 : basePrice + bestAsk; }
+    int64_t depth_at(Side side, int64_t price) const {// resting on that side; a level holds one side at a time
+        int64_t level = price - basePrice;
+        if (level < 0 || level >= int64_t(levels.size())) return 0;
+        return (side == Side::Buy ? level <= bestBid : level >= bestAsk) ? levels[level].qty : 0;
+    }
+    size_t live_orders() const { return orders.size() - freeSlots.size(); }
+    uint64_t rejected_count() const { return rejected; }
+
+    const vector<Fill>& fills() const { return fillLog; }
+    void clear_fills() { fillLog.clear(); }
+};
+
+const uint32_t FLOW_OWNER = 0;
+const uint32_t STRATEGY_OWNER = 1;
+const int FLOW_QUOTE_LEVELS = 5;// passive flow quotes per side per tick
+const double FLOW_QUOTE_STEP = 0.001;// relative spacing of the quote levels, rounded outward like the strategy's limits
+const int FLOW_QUOTE_TTL = 3;// ticks a flow quote rests before the simulator pulls it
+const double FLOW_SWEEP_DEPTH = 0.02;// aggressive flow reaches up to 2% through the touch
+const int ORDER_TTL_TICKS = 2;// the strategy's resting orders are pulled after this many ticks
+
+struct ExecutionReport {
+    enum Kind : uint8_t { Ack, Fill, Done } kind;// Done: the order left the book (filled, cancelled or rejected)
+    uint64_t clientId;
+    SymbolId symbol;
+    Side side;
+    int64_t price;// book ticks of the fill
+    int64_t qty;// Fill: filled qty, Done: unfilled remainder, Ack: qty resting ahead of the order (queue position)
+};
+
+// Where the engine sends orders in book mode. Reports come back through the deliver callback, either
+// synchronously (SimulatedVenue) or after modelled latency (ExchangeSimulator).
+class OrderGateway {
+public:
+    function<void(const ExecutionReport&)> deliver;
+
+    virtual ~OrderGateway() = default;
+    virtual void submit(uint64_t clientId, SymbolId symbol, Side side, int64_t price, int64_t qty, bool immediateOrCancel) = 0;
+    virtual void cancel(uint64_t clientId, SymbolId symbol) = 0;
+    virtual void on_market_data(SymbolId, double, int) {}// lets a synchronous venue run its flow for this tick
+};
+
+// One book per symbol plus synthetic flow: every tick it refreshes passive quotes around the last price
+// and sends aggressive orders of random size and depth, which fill whatever rests in their way.
+class SimulatedVenue : public OrderGateway {
+    vector<unique_ptr<OrderBook>> books;
+    vector<vector<OrderId>> flowQuotes;// ring of FLOW_QUOTE_TTL ticks of quotes per symbol
+    pmr::unsynchronized_pool_resource orderPool;// node storage for the maps below, recycled as orders retire
+    vector<pmr::unordered_map<OrderId, uint64_t>> clientOf;// per symbol, since book ids are only unique within a book
+    pmr::unordered_map<uint64_t, pair<OrderId, Side>> bookIdOf{&orderPool};// resting strategy orders: client id -> book id
+    mt19937_64 rng;
+
+    OrderBook& ensure_book(SymbolId id, double price) {
+        if (id >= books.size()) {
+            books.resize(id + 1);
+            flowQuotes.resize(id + 1);
+            while (clientOf.size() <= id) clientOf.emplace_back(&orderPool);
+        }
+        if (!books[id]) {
+            books[id] = make_unique<OrderBook>(price);
+            flowQuotes[id].assign(FLOW_QUOTE_TTL * FLOW_QUOTE_LEVELS * 2, NO_ORDER);
+        }
+        return *books[id];
+    }
+
+    void retire(uint64_t clientId, SymbolId symbol, Side side, int64_t remaining) {
+        auto it = bookIdOf.find(clientId);
+        if (it != bookIdOf.end()) {
+            clientOf[symbol].erase(it->second.first);
+            bookIdOf.erase(it);
+        }
+        deliver({ExecutionReport::Done, clientId, symbol, side, 0, remaining});
+    }
+
+    // Turns the book's fills into reports for strategy orders. takerClient is the order being added, if any.
+    void report_fills(SymbolId symbol, uint64_t takerClient) {
+        OrderBook& b = *books[symbol];
+        for (const Fill& fill : b.fills()) {
+            Side makerSide = fill.takerSide == Side::Buy ? Side::Sell : Side::Buy;
+            if (fill.takerOwner == STRATEGY_OWNER) {
+                deliver({ExecutionReport::Fill, takerClient, symbol, fill.takerSide, fill.price, fill.qty});
+            }
+            if (fill.makerOwner == STRATEGY_OWNER) {
+                auto it = clientOf[symbol].find(fill.maker);
+                if (it == clientOf[symbol].end()) continue;
+                uint64_t makerClient = it->second;
+                deliver({ExecutionReport::Fill, makerClient, symbol, makerSide, fill.price, fill.qty});
+                if (b.remaining(fill.maker) == 0) retire(makerClient, symbol, makerSide, 0);
+            }
+        }
+        b.clear_fills();
+    }
+
+public:
+    explicit SimulatedVenue(uint64_t seed) : rng(seed) {}
+
+    bool has_book(SymbolId id) const { return id < books.size() && books[id]; }
+    OrderBook& book(SymbolId id) { return *books[id]; }
+
+    // Opens the book at its first price with the window sized for a session trading between low and
+    // high, so the session itself does not grow it.
+    void open_book(SymbolId id, double first, double low, double high) {
+        ensure_book(id, first).reserve_prices(to_book_ticks(low * (1 - FLOW_SWEEP_DEPTH)), to_book_ticks(high * (1 + FLOW_SWEEP_DEPTH)));
+    }
+
+    void submit(uint64_t clientId, SymbolId symbol, Side side, int64_t price, int64_t qty, bool immediateOrCancel) override {
+        OrderBook& b = ensure_book(symbol, from_book_ticks(price));
+        OrderId bookId = b.add(side, price, qty, STRATEGY_OWNER);
+        int64_t filled = 0;
+        for (const Fill& fill : b.fills()) filled += fill.takerOwner == STRATEGY_OWNER ? fill.qty : 0;
+        if (bookId != NO_ORDER) {
+            clientOf[symbol][bookId] = clientId;
+            bookIdOf[clientId] = {bookId, side};
+        }
+        report_fills(symbol, clientId);
+        if (bookId == NO_ORDER) {// filled outright, or the book rejected it
+            retire(clientId, symbol, side, qty - filled);
+            return;
+        }
+        if (immediateOrCancel) {
+            retire(clientId, symbol, side, b.cancel(bookId));
+            return;
+        }
+        int64_t ahead = b.depth_at(side, price) - b.remaining(bookId);// after matching: only our own side is left
+        deliver({ExecutionReport::Ack, clientId, symbol, side, price, ahead});
+    }
+
+    void cancel(uint64_t clientId, SymbolId symbol) override {
+        auto it = bookIdOf.find(clientId);
+        if (it == bookIdOf.end()) return;// already filled or cancelled, its Done is on the way or delivered
+        auto [bookId, side] = it->second;
+        retire(clientId, symbol, side, books[symbol]->cancel(bookId));
+    }
+
+    void on_market_data(SymbolId id, double price, int tick) override {
+        OrderBook& b = ensure_book(id, price);
+        b.reserve_prices(to_book_ticks(price * (1 - FLOW_SWEEP_DEPTH)), to_book_ticks(price * (1 + FLOW_SWEEP_DEPTH)));
+        OrderId* quotes = &flowQuotes[id][(tick % FLOW_QUOTE_TTL) * FLOW_QUOTE_LEVELS * 2];
+        uniform_int_distribution<int64_t> size(50, 500);
+        for (int k = 0; k < FLOW_QUOTE_LEVELS * 2; ++k) {
+            b.cancel(quotes[k]);// the quote placed FLOW_QUOTE_TTL ticks ago, if still resting
+            bool bid = k < FLOW_QUOTE_LEVELS;
+            double offset = FLOW_QUOTE_STEP * (k % FLOW_QUOTE_LEVELS + 1);
+            int64_t level = bid ? book_ticks_at_or_below(Money::from_dollars(price * (1.0 - offset)))
+                                : book_ticks_at_or_above(Money::from_dollars(price * (1.0 + offset)));
+            quotes[k] = b.add(bid ? Side::Buy : Side::Sell, level, size(rng), FLOW_OWNER);
+        }
+        uniform_real_distribution<double> depth(0.0, FLOW_SWEEP_DEPTH);
+        uniform_int_distribution<int64_t> sweep(100, 3000);
+        for (Side side : {Side::Buy, Side::Sell}) {
+            if (rng() % 2) continue;
+            double reach = depth(rng);
+            int64_t limit = side == Side::Buy ? to_book_ticks(price * (1 + reach)) : to_book_ticks(price * (1 - reach));
+            OrderId rest = b.add(side, limit, sweep(rng), FLOW_OWNER);
+            b.cancel(rest);// immediate-or-cancel
+        }
+        report_fills(id, 0);
+    }
+};
+
+// Terms of the protective options bought with every position: maturity in years, rate, volatility.
+const double OPTION_MATURITY = 0.1;
+const double OPTION_RATE = 0.01;
+const double OPTION_VOL = 0.2;
+const double YEARS_PER_TICK = 1.0 / (252.0 * TICKS_PER_DAY);// option life one tick uses up
+
+// OptionsBook re-marks a contract by a Taylor step from its last full reprice until the spot has moved by
+// more than MARK_REPRICE_MOVE (relative), the vol by more than MARK_REPRICE_VOL, or MARK_REPRICE_TICKS
+// ticks have passed.
+const double MARK_REPRICE_MOVE = 0.01;
+const double MARK_REPRICE_VOL = 0.01;
+const int MARK_REPRICE_TICKS = 12;
+
+// Everything the strategy can be tuned by; the defaults are the strategy as originally written.
+struct StrategyParams {
+    int smaWindow = SMA_WINDOW;
+    double limitSlippage = LIMIT_SLIPPAGE;
+    double callStrike = 1.05;// strike of the protective call as a multiple of the price, 5% OTM
+    double putStrike = 0.95;
+    double dropExit = 0.97;// alert-sell once the price falls this far below the SMA
+    double takeProfit = 1.01;// sell once the price is this far above the average cost
+};
+
+// ---- Strategy policies ----
+// The engine's rules are four policies bound at compile time: when to buy, how much, when to exit and how
+// to hedge. Each is a struct of static inline functions over StrategyParams, so a composition compiles to
+// the same branches as rules written in place, with no virtual dispatch on the tick path. The predicates
+// are also used by the branch-free signal pass in update_prices, so they must stay free of side effects.
+// Exit rules only run while shares are held; the engine checks that.
+
+struct BelowSmaSignal {// buy while the price is under its moving average
+    static bool buy(const StrategyParams&, double price, double sma) { return price < sma; }
+};
+
+struct CashSlotSizing {// a buy spends at most balance / positionSlots
+    static int64_t quantity(const StrategyParams&, Money balance, Money limit, double positionSlots) {
+        return checked_quantity(balance.dollars() / limit.dollars() / positionSlots);
+    }
+};
+
+struct TakeProfitOrDropExit {// sell above the SMA at a profit, or on alert ticks once the price drops well below it
+    static bool take_profit(const StrategyParams& p, double price, double sma, Money avgPrice) {
+        return (price > sma) & (price > avgPrice.dollars() * p.takeProfit);
+    }
+    static bool drop_exit(const StrategyParams& p, double price, double sma, int tick) {
+        return (tick % 2 == 0) & (price < sma * p.dropExit);//tick%2==0 runs every 10 min tick=5min
+    }
+};
+
+struct ProtectiveOptionsHedge {// one OTM call and one OTM put with every buy, exercised on alert ticks
+    static constexpr bool buysOptions = true;
+    static double call_strike(const StrategyParams& p, double price) { return price * p.callStrike; }
+    static double put_strike(const StrategyParams& p, double price) { return price * p.putStrike; }
+    static bool exercise_tick(int tick) { return tick % 2 == 0; }
+};
+
+struct NoHedge {
+    static constexpr bool buysOptions = false;
+    static double call_strike(const StrategyParams&, double) { return 0.0; }
+    static double put_strike(const StrategyParams&, double) { return 0.0; }
+    static bool exercise_tick(int) { return false; }
+};
+
+template <class SignalPolicy, class SizingPolicy, class ExitPolicy, class HedgePolicy>
+struct StrategyPolicies {
+    using Signal = SignalPolicy;
+    using Sizing = SizingPolicy;
+    using Exit = ExitPolicy;
+    using Hedge = HedgePolicy;
+};
+
+// The strategy as originally written.
+using DefaultStrategy = StrategyPolicies<BelowSmaSignal, CashSlotSizing, TakeProfitOrDropExit, ProtectiveOptionsHedge>;
+
+// ---- Rule programs ----
+// Entry and exit conditions as text, such as "price < sma * 0.97", so a rule can change without a rebuild.
+// A rule reads price, sma, avgPrice, shares and tick, and combines them with + - * / %, the comparisons
+// < <= > >= == != and and/or/not (or && || !); nonzero is true. It compiles to register bytecode that runs
+// one instruction at a time over a block of RULE_BLOCK symbols, so dispatch is paid once per block and each
+// instruction body is a straight loop the compiler vectorizes. price and sma are read in place. Parts that
+// depend only on tick are computed once per run in a scalar side program, and a top-level "and" with such a
+// part skips the blocks entirely when it is false; parts that are constant fold at compile time.
+
+const size_t RULE_BLOCK = 256;
+const size_t RULE_LANES = 16;// a partial block is padded to a multiple of this
+const int RULE_MAX_REGISTERS = 16;
+const uint8_t RULE_PRICE_OPERAND = RULE_MAX_REGISTERS;// operands past the registers read the input columns
+const uint8_t RULE_SMA_OPERAND = RULE_MAX_REGISTERS + 1;
+const size_t RULE_MAX_SLOTS = 256;
+
+enum class RuleOp : uint8_t {
+    LoadPrice, LoadSma, LoadAvgPrice, LoadShares, LoadTick, Splat,// Splat: broadcast scalar slot a
+    Add, Sub, Mul, Div, Mod, Lt, Le, Gt, Ge, Eq, Ne, And, Or, Not
+};
+
+template <RuleOp Op> inline double rule_apply(double x, double y) {
+    if constexpr (Op == RuleOp::Add) return x + y;
+    else if constexpr (Op == RuleOp::Sub) return x - y;
+    else if constexpr (Op == RuleOp::Mul) return x * y;
+    else if constexpr (Op == RuleOp::Div) return x / y;
+    else if constexpr (Op == RuleOp::Mod) return fmod(x, y);
+    else if constexpr (Op == RuleOp::Lt) return double(x < y);
+    else if constexpr (Op == RuleOp::Le) return double(x <= y);
+    else if constexpr (Op == RuleOp::Gt) return double(x > y);
+    else if constexpr (Op == RuleOp::Ge) return double(x >= y);
+    else if constexpr (Op == RuleOp::Eq) return double(x == y);
+    else if constexpr (Op == RuleOp::Ne) return double(x != y);
+    else if constexpr (Op == RuleOp::And || Op == RuleOp::Or) {// min/max of selects: forms -O2 vectorizes
+        double p = x != 0 ? 1.0 : 0.0, q = y != 0 ? 1.0 : 0.0;
+        if constexpr (Op == RuleOp::And) return p < q ? p : q;
+        else return p > q ? p : q;
+    }
+    else return x == 0 ? 1.0 : 0.0;// Not
+}
+
+double rule_apply(RuleOp op, double x, double y) {
+    switch (op) {
+        case RuleOp::Add: return rule_apply<RuleOp::Add>(x, y);
+        case RuleOp::Sub: return rule_apply<RuleOp::Sub>(x, y);
+        case RuleOp::Mul: return rule_apply<RuleOp::Mul>(x, y);
+        case RuleOp::Div: return rule_apply<RuleOp::Div>(x, y);
+        case RuleOp::Mod: return rule_apply<RuleOp::Mod>(x, y);
+        case RuleOp::Lt: return rule_apply<RuleOp::Lt>(x, y);
+        case RuleOp::Le: return rule_apply<RuleOp::Le>(x, y);
+        case RuleOp::Gt: return rule_apply<RuleOp::Gt>(x, y);
+        case RuleOp::Ge: return rule_apply<RuleOp::Ge>(x, y);
+        case RuleOp::Eq: return rule_apply<RuleOp::Eq>(x, y);
+        case RuleOp::Ne: return rule_apply<RuleOp::Ne>(x, y);
+        case RuleOp::And: return rule_apply<RuleOp::And>(x, y);
+        case RuleOp::Or: return rule_apply<RuleOp::Or>(x, y);
+        case RuleOp::Not: return rule_apply<RuleOp::Not>(x, y);
+        default: throw runtime_error("not a rule operator");
+    }
+}
+
+// One instruction over a block of len symbols, a multiple of RULE_LANES; b is a register, or the scalar k
+// when scalarB. Inner loops of a fixed trip count and a destination that never overlaps its sources are
+// what -O2's cheap vectorizer needs to take them.
+template <RuleOp Op>
+void rule_block(double* __restrict d, const double* __restrict a, const double* __restrict b, double k, bool scalarB, size_t len) {
+    for (size_t i = 0; i < len; i += RULE_LANES) {
+        if (scalarB) {
+            for (size_t j = 0; j < RULE_LANES; ++j) d[i + j] = rule_apply<Op>(a[i + j], k);
+        } else {
+            for (size_t j = 0; j < RULE_LANES; ++j) d[i + j] = rule_apply<Op>(a[i + j], b[i + j]);
+        }
+    }
+}
+
+// double(v) for any int64: two exact int32 halves and one rounding give the same bits, in a form SSE2 can
+// vectorize, since it has no 64-bit integer conversion.
+inline double rule_exact_double(int64_t v) {
+    double hi = double(int32_t(v >> 32)), lo = double(int32_t(uint32_t(v) ^ 0x80000000u)) + 2147483648.0;
+    return hi * 4294967296.0 + lo;
+}
+
+// d[i] = value(i) for the first len symbols of a block, whole lanes first so they vectorize.
+template <class F> void rule_column(double* __restrict d, size_t len, F value) {
+    const size_t whole = len / RULE_LANES * RULE_LANES;
+    for (size_t i = 0; i < whole; i += RULE_LANES) {
+        for (size_t j = 0; j < RULE_LANES; ++j) d[i + j] = value(i + j);
+    }
+    for (size_t i = whole; i < len; ++i) d[i] = value(i);
+}
+
+struct RuleInputs {// per-symbol columns, each pointing at the first symbol evaluated
+    const double* price;
+    const double* sma;
+    const Money* avgPrice;
+    const int64_t* shares;
+    int tick;
+};
+
+class RuleProgram {
+    struct Node {
+        RuleOp op;// a Load, Splat for a constant, or the operator
+        double value = 0.0;
+        int left = -1, right = -1;
+        bool varying = false;// reads a per-symbol input
+        bool usesTick = false;
+    };
+    struct Instr {// block program: dst is a register, a and b registers or input operands; scalar program: slots
+        RuleOp op;
+        uint8_t dst, a, b;
+        bool scalarB;// b is a slot
+    };
+    struct Operand {
+        bool scalar;
+        uint8_t index;
+    };
+
+    string text;
+    size_t pos = 0;
+    vector<Node> nodes;
+    vector<Instr> code, uniformCode;
+    vector<double> slots;// constants and the scalar program's results
+    vector<double> registers;
+    vector<double> tailPrice, tailSma;// a partial block's inputs, padded to whole lanes
+    vector<uint8_t> freeRegisters;
+    vector<uint8_t> guards;// slots that must be nonzero for the rule to hold anywhere
+    int registerCount = 0;
+    uint8_t result = 0;
+    bool scalarResult = true;
+
+    [[noreturn]] void fail(const string& what) const {
+        throw runtime_error("rule \"" + text + "\": " + what + " at column " + to_string(pos + 1));
+    }
+
+    void skip_space() {
+        while (pos < text.size() && isspace((unsigned char)text[pos])) ++pos;
+    }
+
+    bool accept(string_view token) {
+        skip_space();
+        if (text.compare(pos, token.size(), token) != 0) return false;
+        bool word = isalpha((unsigned char)token[0]);
+        size_t end = pos + token.size();
+        if (word && end < text.size() && (isalnum((unsigned char)text[end]) || text[end] == '_')) return false;
+        pos = end;
+        return true;
+    }
+
+    int node(RuleOp op, int left, int right) {
+        Node n{op};
+        n.left = left;
+        n.right = right;
+        n.varying = nodes[left].varying || (right >= 0 && nodes[right].varying);
+        n.usesTick = nodes[left].usesTick || (right >= 0 && nodes[right].usesTick);
+        nodes.push_back(n);
+        return int(nodes.size() - 1);
+    }
+
+    int parse_or() {
+        int left = parse_and();
+        while (accept("or") || accept("||")) left = node(RuleOp::Or, left, parse_and());
+        return left;
+    }
+
+    int parse_and() {
+        int left = parse_not();
+        while (accept("and") || accept("&&")) left = node(RuleOp::And, left, parse_not());
+        return left;
+    }
+
+    int parse_not() {
+        skip_space();
+        bool bang = text.compare(pos, 1, "!") == 0 && text.compare(pos, 2, "!=") != 0;
+        if (accept("not") || (bang && accept("!"))) return node(RuleOp::Not, parse_not(), -1);
+        return parse_comparison();
+    }
+
+    int parse_comparison() {
+        int left = parse_sum();
+        const pair<const char*, RuleOp> comparisons[] = {{"<=", RuleOp::Le}, {">=", RuleOp::Ge}, {"==", RuleOp::Eq},
+                                                         {"!=", RuleOp::Ne}, {"<", RuleOp::Lt}, {">", RuleOp::Gt}};
+        for (const auto& [token, op] : comparisons) {
+            if (accept(token)) return node(op, left, parse_sum());
+        }
+        return left;
+    }
+
+    int parse_sum() {
+        int left = parse_product();
+        for (;;) {
+            if (accept("+")) left = node(RuleOp::Add, left, parse_product());
+            else if (accept("-")) left = node(RuleOp::Sub, left, parse_product());
+            else return left;
+        }
+    }
+
+    int parse_product() {
+        int left = parse_unary();
+        for (;;) {
+            if (accept("*")) left = node(RuleOp::Mul, left, parse_unary());
+            else if (accept("/")) left = node(RuleOp::Div, left, parse_unary());
+            else if (accept("%")) left = node(RuleOp::Mod, left, parse_unary());
+            else return left;
+        }
+    }
+
+    int parse_unary() {
+        if (accept("-")) {
+            nodes.push_back({RuleOp::Splat});
+            int zero = int(nodes.size() - 1);
+            return node(RuleOp::Sub, zero, parse_unary());
+        }
+        return parse_primary();
+    }
+
+    int parse_primary() {
+        skip_space();
+        if (accept("(")) {
+            int inner = parse_or();
+            if (!accept(")")) fail("expected ')'");
+            return inner;
+        }
+        if (pos < text.size() && (isdigit((unsigned char)text[pos]) || text[pos] == '.')) {
+            Node n{RuleOp::Splat};
+            auto [end, ec] = from_chars(text.data() + pos, text.data() + text.size(), n.value);
+            if (ec != errc()) fail("bad number");
+            pos = size_t(end - text.data());
+            nodes.push_back(n);
+            return int(nodes.size() - 1);
+        }
+        const pair<const char*, RuleOp> inputs[] = {{"price", RuleOp::LoadPrice}, {"sma", RuleOp::LoadSma},
+                                                    {"avgPrice", RuleOp::LoadAvgPrice}, {"shares", RuleOp::LoadShares},
+                                                    {"tick", RuleOp::LoadTick}};
+        for (const auto& [name, op] : inputs) {
+            if (!accept(name)) continue;
+            Node n{op};
+            n.varying = op != RuleOp::LoadTick;
+            n.usesTick = op == RuleOp::LoadTick;
+            nodes.push_back(n);
+            return int(nodes.size() - 1);
+        }
+        fail(pos < text.size() ? "unexpected input" : "unexpected end");
+    }
+
+    double evaluate(int id, double tick) const {// constant and tick-only subtrees
+        const Node& n = nodes[id];
+        if (n.op == RuleOp::Splat) return n.value;
+        if (n.op == RuleOp::LoadTick) return tick;
+        return rule_apply(n.op, evaluate(n.left, tick), n.right >= 0 ? evaluate(n.right, tick) : 0.0);
+    }
+
+    uint8_t new_slot(double value) {
+        if (slots.size() == RULE_MAX_SLOTS) fail("too many constants");
+        slots.push_back(value);
+        return uint8_t(slots.size() - 1);
+    }
+
+    uint8_t emit_uniform(int id) {// a scalar slot: folded if constant, else recomputed at the start of every run
+        const Node& n = nodes[id];
+        if (!n.usesTick) return new_slot(evaluate(id, 0.0));
+        if (n.op == RuleOp::LoadTick) {
+            uint8_t s = new_slot(0.0);
+            uniformCode.push_back({RuleOp::LoadTick, s, 0, 0, true});
+            return s;
+        }
+        uint8_t a = emit_uniform(n.left);
+        uint8_t b = n.right >= 0 ? emit_uniform(n.right) : 0;
+        uint8_t s = new_slot(0.0);
+        uniformCode.push_back({n.op, s, a, b, true});
+        return s;
+    }
+
+    uint8_t take_register() {
+        if (!freeRegisters.empty()) {
+            uint8_t r = freeRegisters.back();
+            freeRegisters.pop_back();
+            return r;
+        }
+        if (registerCount == RULE_MAX_REGISTERS) fail("rule needs too many registers");
+        return uint8_t(registerCount++);
+    }
+
+    static bool mirror(RuleOp op, RuleOp& swapped) {// swapped(b, a) == op(a, b)
+        switch (op) {
+            case RuleOp::Add: case RuleOp::Mul: case RuleOp::Eq: case RuleOp::Ne: case RuleOp::And: case RuleOp::Or:
+                swapped = op;
+                return true;
+            case RuleOp::Lt: swapped = RuleOp::Gt; return true;
+            case RuleOp::Le: swapped = RuleOp::Ge; return true;
+            case RuleOp::Gt: swapped = RuleOp::Lt; return true;
+            case RuleOp::Ge: swapped = RuleOp::Le; return true;
+            default: return false;
+        }
+    }
+
+    static bool writable(Operand x) { return !x.scalar && x.index < RULE_MAX_REGISTERS; }
+
+    void release(Operand x, uint8_t keep) {
+        if (writable(x) && x.index != keep) freeRegisters.push_back(x.index);
+    }
+
+    Operand emit(int id) {
+        const Node n = nodes[id];
+        if (!n.varying) return {true, emit_uniform(id)};
+        if (n.op == RuleOp::LoadPrice) return {false, RULE_PRICE_OPERAND};
+        if (n.op == RuleOp::LoadSma) return {false, RULE_SMA_OPERAND};
+        if (n.left < 0) {
+            uint8_t r = take_register();
+            code.push_back({n.op, r, 0, 0, false});
+            return {false, r};
+        }
+        if (n.op == RuleOp::Not) {// results go to a fresh register, never over an operand (see rule_block)
+            Operand x = emit(n.left);
+            uint8_t dst = take_register();
+            code.push_back({RuleOp::Not, dst, x.index, 0, false});
+            release(x, dst);
+            return {false, dst};
+        }
+        Operand l = emit(n.left), r = emit(n.right);
+        RuleOp op = n.op;
+        if (l.scalar) {
+            RuleOp swapped;
+            if (mirror(op, swapped)) {
+                swap(l, r);
+                op = swapped;
+            } else {
+                uint8_t t = take_register();
+                code.push_back({RuleOp::Splat, t, l.index, 0, true});
+                l = {false, t};
+            }
+        }
+        uint8_t dst = take_register();
+        code.push_back({op, dst, l.index, r.index, r.scalar});
+        release(l, dst);
+        release(r, dst);
+        return {false, dst};
+    }
+
+public:
+    RuleProgram() = default;// always false
+
+    explicit RuleProgram(string source) : text(move(source)) {
+        int root = parse_or();
+        skip_space();
+        if (pos != text.size()) fail("unexpected input");
+        while (nodes[root].op == RuleOp::And && (!nodes[nodes[root].left].varying || !nodes[nodes[root].right].varying)) {
+            bool leftUniform = !nodes[nodes[root].left].varying;
+            guards.push_back(emit_uniform(leftUniform ? nodes[root].left : nodes[root].right));
+            root = leftUniform ? nodes[root].right : nodes[root].left;
+        }
+        Operand out = emit(root);
+        result = out.index;
+        scalarResult = out.scalar;
+        registers.assign(size_t(registerCount) * RULE_BLOCK, 0.0);
+        tailPrice.assign(RULE_BLOCK, 0.0);
+        tailSma.assign(RULE_BLOCK, 0.0);
+        nodes.clear();
+    }
+
+    const string& source() const { return text; }
+    size_t instruction_count() const { return code.size() + uniformCode.size(); }
+
+    // out[i] = whether the rule holds for symbol i of the n in inputs. Does not allocate.
+    void run(const RuleInputs& in, size_t n, uint8_t* out) {
+        for (const Instr& ins : uniformCode) {
+            slots[ins.dst] = ins.op == RuleOp::LoadTick ? double(in.tick) : rule_apply(ins.op, slots[ins.a], slots[ins.b]);
+        }
+        for (uint8_t guard : guards) {
+            if (slots[guard] == 0) {
+                memset(out, 0, n);
+                return;
+            }
+        }
+        if (scalarResult) {
+            memset(out, !slots.empty() && slots[result] != 0, n);
+            return;
+        }
+        const double* operand[RULE_MAX_REGISTERS + 2];
+        for (int r = 0; r < registerCount; ++r) operand[r] = &registers[size_t(r) * RULE_BLOCK];
+        for (size_t base = 0; base < n; base += RULE_BLOCK) {
+            const size_t len = min(RULE_BLOCK, n - base);
+            const size_t lanes = (len + RULE_LANES - 1) / RULE_LANES * RULE_LANES;
+            operand[RULE_PRICE_OPERAND] = in.price + base;
+            operand[RULE_SMA_OPERAND] = in.sma + base;
+            if (lanes != len) {// lanes past len compute on stale values and are never stored
+                copy(in.price + base, in.price + n, tailPrice.begin());
+                copy(in.sma + base, in.sma + n, tailSma.begin());
+                operand[RULE_PRICE_OPERAND] = tailPrice.data();
+                operand[RULE_SMA_OPERAND] = tailSma.data();
+            }
+            for (const Instr& ins : code) {
+                double* d = &registers[ins.dst * RULE_BLOCK];
+                switch (ins.op) {// loads and Splat take no register operands; Splat's a is a slot
+                    case RuleOp::LoadPrice: case RuleOp::LoadSma: case RuleOp::LoadTick: continue;// read in place, or scalar only
+                    case RuleOp::LoadAvgPrice:// Money::dollars, bit for bit
+                        rule_column(d, len, [&](size_t i) { return rule_exact_double(in.avgPrice[base + i].micros) / MONEY_UNITS_PER_DOLLAR; });
+                        continue;
+                    case RuleOp::LoadShares:
+                        rule_column(d, len, [&](size_t i) { return rule_exact_double(in.shares[base + i]); });
+                        continue;
+                    case RuleOp::Splat: fill(d, d + lanes, slots[ins.a]); continue;
+                    default: break;
+                }
+                const double* a = operand[ins.a];
+                const double* b = ins.scalarB ? nullptr : operand[ins.b];
+                const double k = ins.scalarB ? slots[ins.b] : 0.0;
+                switch (ins.op) {
+                    case RuleOp::Add: rule_block<RuleOp::Add>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Sub: rule_block<RuleOp::Sub>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Mul: rule_block<RuleOp::Mul>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Div: rule_block<RuleOp::Div>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Mod: rule_block<RuleOp::Mod>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Lt: rule_block<RuleOp::Lt>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Le: rule_block<RuleOp::Le>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Gt: rule_block<RuleOp::Gt>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Ge: rule_block<RuleOp::Ge>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Eq: rule_block<RuleOp::Eq>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Ne: rule_block<RuleOp::Ne>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::And: rule_block<RuleOp::And>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Or: rule_block<RuleOp::Or>(d, a, b, k, ins.scalarB, lanes); break;
+                    case RuleOp::Not: rule_block<RuleOp::Not>(d, a, a, 0.0, true, lanes); break;
+                    default: break;
+                }
+            }
+            const double* r = operand[result];
+            for (size_t i = 0; i < len; ++i) out[base + i] = r[i] != 0;
+        }
+    }
+};
+
+// The rules a ScriptedStrategy engine trades by. The exit rules only run while shares are held, and every
+// rule sees the symbol as it stood before this tick's trades.
+const char* const DEFAULT_BUY_RULE = "price < sma";
+
+struct RuleSet {// default-constructed rules never hold
+    RuleProgram buy, takeProfit, dropExit;
+};
+
+// The default strategy as rules, its thresholds written from params in shortest round-trip form so the
+// rules compare against the very doubles the compiled policies use.
+RuleSet default_rules(const StrategyParams& params = StrategyParams()) {
+    auto number = [](double value) {
+        char text[32];
+        return string(text, to_chars(text, text + sizeof(text), value).ptr);
+    };
+    return {RuleProgram(DEFAULT_BUY_RULE), RuleProgram("price > sma and price > avgPrice * " + number(params.takeProfit)),
+            RuleProgram("tick % 2 == 0 and price < sma * " + number(params.dropExit))};
+}
+
+// Signal and exit policies that defer to the engine's RuleSet (see BasicTradingEngine::set_rules).
+struct RuleSignal {};
+struct RuleExit {};
+using ScriptedStrategy = StrategyPolicies<RuleSignal, CashSlotSizing, RuleExit, ProtectiveOptionsHedge>;
+
+// Struct-of-arrays state for the whole universe, indexed by SymbolId.
+// Every field is its own contiguous array so cross-sectional passes stream through memory.
+struct UniverseState {
+    size_t window = SMA_WINDOW;
+    vector<double> priceRing;// rolling price history, `window` slots per symbol: [id * window + slot]
+    vector<uint32_t> ringHead;
+    vector<uint32_t> samples;// prices seen, saturates at window
+    vector<uint32_t> sinceRenorm;
+    vector<double> windowSum;// running sum so the SMA is O(1) per tick
+    vector<double> sma;
+    vector<int64_t> shares;
+    vector<Money> avgPrice;
+    vector<double> callTrigger, putTrigger;// mirror OptionInventory's triggers so the signal pass never touches Position
+
+    size_t size() const { return shares.size(); }
+
+    void add_symbol() {
+        priceRing.resize(priceRing.size() + window, 0.0);
+        ringHead.push_back(0);
+        samples.push_back(0);
+        sinceRenorm.push_back(0);
+        windowSum.push_back(0.0);
+        sma.push_back(0.0);
+        shares.push_back(0);
+        avgPrice.push_back(Money());
+        callTrigger.push_back(INFINITY);
+        putTrigger.push_back(-INFINITY);
+    }
+
+    void push_price(size_t id, double price) {
+        double* ring = &priceRing[id * window];
+        windowSum[id] += price - ring[ringHead[id]];// slot holds 0 until the window has filled once
+        ring[ringHead[id]] = price;
+        if (++ringHead[id] == window) ringHead[id] = 0;
+        if (samples[id] < window) ++samples[id];
+        if (++sinceRenorm[id] == SMA_RENORM_INTERVAL) {
+            windowSum[id] = accumulate(ring, ring + window, 0.0);
+            sinceRenorm[id] = 0;
+        }
+        sma[id] = windowSum[id] / window;
+    }
+
+    // Takes the SMA from a precomputed series instead of the price ring, which is left untouched.
+    void adopt_sma(size_t id, double value) {
+        if (samples[id] < window) ++samples[id];
+        sma[id] = value;
+    }
+
+    bool ready(size_t id) const { return samples[id] == window; }
+};
+
+// Clock-aware marks and Greeks of every held contract, kept per underlying. Each contract keeps the spot,
+// time, vol and Greeks of its last full reprice (its anchor) and is re-marked every tick by a Taylor step
+// from there; only contracts that drifted past the MARK_REPRICE_* limits go through option_greeks_batch.
+// The engine reports every contract bought (add), exercised (remove) and settled (clear); add hands back
+// the contract's slot, which the contract carries so that remove is O(1). Slots stay put until the
+// symbol is cleared, and freed ones are reused. The marks and the reprice columns live in the engine's
+// DayArena and are released with it.
+class OptionsBook {
+    struct Mark {
+        double strike, expiry, premium;// expiry: years left at tick 0, so T = expiry - tick * YEARS_PER_TICK
+        bool isCall;
+        int boughtTick;
+        bool live = true;// false once removed, until add reuses the slot
+        bool anchored = false;
+        double anchorSpot = 0.0, anchorVol = 0.0, anchorT = 0.0;
+        int anchorTick = 0;
+        Greeks anchor, now;
+    };
+    pmr::memory_resource* memory;
+    vector<pmr::vector<Mark>> marks;// by SymbolId
+    vector<pmr::vector<uint32_t>> freeSlots;// removed marks per symbol
+    vector<double> lastSpot, symbolVol, premiumPaid;
+    vector<Greeks> perSymbol;
+    int clock = 0;
+    size_t repricedCount = 0, taylorCount = 0;
+    pmr::vector<pair<Mark*, uint32_t>> pending{memory};// contracts waiting for a full reprice, with their symbol
+    pmr::vector<double> S{memory}, K{memory}, T{memory}, r{memory}, vol{memory}, value{memory}, delta{memory},
+        gamma{memory}, vega{memory}, theta{memory}, rho{memory};// the batch kernel's columns
+    pmr::vector<uint8_t> isCall{memory};
+
+    double years_left(const Mark& m) const { return m.expiry - clock * YEARS_PER_TICK; }
+
+    void reprice() {
+        size_t n = pending.size();
+        for (auto* column : {&S, &K, &T, &r, &vol, &value, &delta, &gamma, &vega, &theta, &rho}) column->resize(n);
+        isCall.resize(n);
+        for (size_t k = 0; k < n; ++k) {
+            const Mark& m = *pending[k].first;
+            S[k] = lastSpot[pending[k].second];
+            K[k] = m.strike;
+            T[k] = years_left(m);
+            r[k] = OPTION_RATE;
+            vol[k] = symbolVol[pending[k].second];
+            isCall[k] = m.isCall;
+        }
+        OptionGreeksOut out = {value.data(), delta.data(), gamma.data(), vega.data(), theta.data(), rho.data()};
+        option_greeks_batch(S.data(), K.data(), T.data(), r.data(), vol.data(), isCall.data(), out, n);
+        for (size_t k = 0; k < n; ++k) {
+            Mark& m = *pending[k].first;
+            m.anchor = {value[k], delta[k], gamma[k], vega[k], theta[k], rho[k]};
+            m.now = m.anchor;
+            m.anchorSpot = S[k];
+            m.anchorVol = vol[k];
+            m.anchorT = T[k];
+            m.anchorTick = clock;
+            m.anchored = true;
+        }
+        repricedCount += n;
+    }
+
+    // Re-marks the contracts of symbols [first, last) at the current clock and sums them per symbol.
+    void mark(size_t first, size_t last) {
+        pending.clear();
+        for (size_t id = first; id < last; ++id) {
+            double spot = lastSpot[id], sigma = symbolVol[id];
+            for (Mark& m : marks[id]) {
+                if (!m.live) continue;
+                double dS = spot - m.anchorSpot, dVol = sigma - m.anchorVol;
+                if (!m.anchored || fabs(dS) > MARK_REPRICE_MOVE * m.anchorSpot || fabs(dVol) > MARK_REPRICE_VOL ||
+                    clock - m.anchorTick >= MARK_REPRICE_TICKS) {
+                    pending.emplace_back(&m, uint32_t(id));
+                    continue;
+                }
+                m.now = m.anchor;
+                m.now.value += m.anchor.delta * dS + 0.5 * m.anchor.gamma * dS * dS + m.anchor.vega * dVol +
+                               m.anchor.theta * (m.anchorT - years_left(m));
+                m.now.delta += m.anchor.gamma * dS;
+                ++taylorCount;
+            }
+        }
+        if (!pending.empty()) reprice();
+        for (size_t id = first; id < last; ++id) {
+            Greeks g;
+            for (const Mark& m : marks[id]) {
+                if (m.live) g += m.now;
+            }
+            perSymbol[id] = g;
+        }
+    }
+
+public:
+    explicit OptionsBook(pmr::memory_resource* dayMemory) : memory(dayMemory) {}
+
+    void add_symbol() {
+        marks.emplace_back(memory);
+        freeSlots.emplace_back(memory);
+        lastSpot.push_back(0.0);
+        symbolVol.push_back(OPTION_VOL);
+        premiumPaid.push_back(0.0);
+        perSymbol.emplace_back();
+    }
+
+    // A new contract has no anchor yet and is fully priced at the next mark. Returns its slot.
+    uint32_t add(size_t id, const OptionContract& opt) {
+        Mark m;
+        m.strike = opt.strike;
+        m.expiry = opt.timeToMaturity + opt.boughtTick * YEARS_PER_TICK;
+        m.premium = opt.premium;
+        m.isCall = opt.isCall;
+        m.boughtTick = opt.boughtTick;
+        premiumPaid[id] += opt.premium;
+        if (freeSlots[id].empty()) {
+            marks[id].push_back(m);
+            return uint32_t(marks[id].size() - 1);
+        }
+        uint32_t slot = freeSlots[id].back();
+        freeSlots[id].pop_back();
+        marks[id][slot] = m;
+        return slot;
+    }
+
+    void remove(size_t id, const OptionContract& opt) {// opt.markSlot as add returned it
+        Mark& m = marks[id][opt.markSlot];
+        premiumPaid[id] -= m.premium;
+        m.live = false;
+        freeSlots[id].push_back(opt.markSlot);
+    }
+
+    void clear(size_t id) {
+        marks[id].clear();
+        freeSlots[id].clear();
+        premiumPaid[id] = 0.0;
+        perSymbol[id] = Greeks();
+    }
+
+    // Drops all storage ahead of a DayArena reset; every symbol must have been cleared.
+    void release() {
+        for (auto& held : marks) held = pmr::vector<Mark>(memory);
+        for (auto& slots : freeSlots) slots = pmr::vector<uint32_t>(memory);
+        pending = decltype(pending)(memory);
+        for (auto* column : {&S, &K, &T, &r, &vol, &value, &delta, &gamma, &vega, &theta, &rho}) *column = pmr::vector<double>(memory);
+        isCall = pmr::vector<uint8_t>(memory);
+    }
+
+    void load(size_t id, OptionInventory& held) {// renumbers the contracts' slots
+        clear(id);
+        held.for_each([&](OptionContract& opt) { opt.markSlot = add(id, opt); });
+    }
+
+    void set_vol(size_t id, double sigma) { symbolVol[id] = sigma; }// used from the next mark on
+
+    // Whole universe at once: prices[id] for every symbol, as passed to TradingEngine::update_prices.
+    void refresh_all(int tick, const double* prices) {
+        clock = tick;
+        copy(prices, prices + lastSpot.size(), lastSpot.begin());
+        mark(0, lastSpot.size());
+    }
+
+    // One symbol's price moved; the other symbols keep their marks until their own prices arrive.
+    void refresh_symbol(size_t id, double price, int tick) {
+        clock = tick;
+        lastSpot[id] = price;
+        mark(id, id + 1);
+    }
+
+    const Greeks& symbol(size_t id) const { return perSymbol[id]; }
+
+    Greeks total() const {
+        Greeks g;
+        for (const Greeks& s : perSymbol) g += s;
+        return g;
+    }
+
+    // Mark value of the held contracts less the premiums paid for them.
+    double unrealized_pnl() const { return total().value - accumulate(premiumPaid.begin(), premiumPaid.end(), 0.0); }
+
+    // Every contract fully repriced at the current clock, without touching the anchors; for checks.
+    Greeks exact_total() const {
+        Greeks g;
+        for (size_t id = 0; id < marks.size(); ++id) {
+            for (const Mark& m : marks[id]) {
+                if (m.live) g += option_greeks(lastSpot[id], m.strike, years_left(m), OPTION_RATE, symbolVol[id], m.isCall);
+            }
+        }
+        return g;
+    }
+
+    size_t contract_count() const {
+        size_t n = 0;
+        for (size_t id = 0; id < marks.size(); ++id) n += marks[id].size() - freeSlots[id].size();
+        return n;
+    }
+    size_t repriced_count() const { return repricedCount; }
+    size_t taylor_count() const { return taylorCount; }
+};
+
+// Policies is a StrategyPolicies composition; the rules it binds are inlined into trade() and the signal pass.
+template <class Policies = DefaultStrategy>
+class BasicTradingEngine {
+    using Signal = typename Policies::Signal;
+    using Sizing = typename Policies::Sizing;
+    using Exit = typename Policies::Exit;
+    using Hedge = typename Policies::Hedge;
+    static constexpr bool scripted = is_same_v<Signal, RuleSignal>;
+    static_assert(scripted == is_same_v<Exit, RuleExit>, "rule signals and rule exits come together");
+    struct NoRules {};
+
+    SymbolRegistry symbols;
+    UniverseState state;
+    DayArena dayArena;// option inventories and the options book; reset by end_of_day_settlement
+    vector<Position> portfolio;// options held per company, indexed by SymbolId
+    vector<uint8_t> actionable;// scratch for update_prices, one flag per symbol
+    Money balance;
+    double positionSlots = COMPANIES;// a buy spends at most balance / positionSlots
+    LogChannel* eventLog = nullptr;// trades are not logged until set_event_log
+    StrategyParams params;
+    OrderGateway* gateway = nullptr;// null: orders fill instantly at their limit price
+    unique_ptr<OrderGateway> ownedGateway;
+
+    struct WorkingOrder {
+        SymbolId symbol;
+        Side side;
+        Money limit;
+        int64_t remaining;
+        EventType fillEvent;
+    };
+    pmr::unsynchronized_pool_resource orderPool;// recycles the map nodes of orders that are done
+    pmr::unordered_map<uint64_t, WorkingOrder> workingOrders{&orderPool};// by client id, until the gateway reports Done
+    uint64_t nextClientId = 1;
+    vector<uint64_t> workingBuy, workingSell;// client id of the current order per side and symbol, 0 for none
+    vector<int> buyPlacedTick, sellPlacedTick;
+    vector<int64_t> sellCommitted;// shares in live sell orders, including ones whose cancel is still in flight
+    int currentTick = 0;
+    vector<EventRecord>* trace = nullptr;
+    bool optionMarking = false;
+    OptionsBook optionsBook{&dayArena};
+    conditional_t<scripted, RuleSet, NoRules> rules;
+    bool customRules = false;// set_rules was called, so the rules no longer follow params
+    vector<uint8_t> ruleBuy, ruleTakeProfit, ruleDropExit;// this tick's rule results, scripted engines only
+
+    void emit(const EventRecord& record) {
+        if (eventLog) eventLog->log(record);
+        if (trace) trace->push_back(record);
+    }
+
+    // Buys reserve qty * limit up front; fills return the price improvement and Done releases the rest.
+    void on_report(const ExecutionReport& report) {
+        auto it = workingOrders.find(report.clientId);
+        if (it == workingOrders.end()) return;
+        WorkingOrder& order = it->second;
+        SymbolId id = order.symbol;
+        int64_t& shares = state.shares[id];
+        Money& avgPrice = state.avgPrice[id];
+        if (report.kind == ExecutionReport::Fill) {
+            Money fillPrice = money_from_book_ticks(report.price);
+            int64_t qty = report.qty;
+            order.remaining -= qty;
+            if (order.side == Side::Buy) {
+                balance += (order.limit - fillPrice) * qty;
+                avgPrice = (avgPrice * shares + fillPrice * qty).per(shares + qty);
+                shares += qty;
+            } else {
+                balance += fillPrice * qty;
+                shares -= qty;
+                sellCommitted[id] -= qty;
+                if (shares == 0) avgPrice = Money();
+            }
+            emit({order.fillEvent, id, qty, currentTick, fillPrice.dollars(), 0.0});
+        } else if (report.kind == ExecutionReport::Done) {
+            if (order.side == Side::Buy) balance += order.limit * order.remaining;
+            else sellCommitted[id] -= order.remaining;
+            if (workingBuy[id] == report.clientId) workingBuy[id] = 0;
+            if (workingSell[id] == report.clientId) workingSell[id] = 0;
+            workingOrders.erase(it);
+        }
+    }
+
+    void cancel_order(uint64_t clientId, SymbolId id) {
+        if (clientId) gateway->cancel(clientId, id);
+    }
+
+    uint64_t send_order(SymbolId id, Side side, int64_t limitTicks, int64_t qty, bool immediateOrCancel, EventType fillEvent) {
+        uint64_t clientId = nextClientId++;
+        workingOrders[clientId] = {id, side, money_from_book_ticks(limitTicks), qty, fillEvent};
+        (side == Side::Buy ? workingBuy : workingSell)[id] = clientId;// set first: a synchronous venue may report Done inside submit
+        gateway->submit(clientId, id, side, limitTicks, qty, immediateOrCancel);
+        return clientId;
+    }
+
+    void place_buy(SymbolId id, int64_t qty, Money limit, int tick) {
+        cancel_order(workingSell[id], id);// the signal flipped, and our own orders must not cross
+        int64_t limitTicks = book_ticks_at_or_below(limit);
+        balance -= money_from_book_ticks(limitTicks) * qty;
+        buyPlacedTick[id] = tick;
+        send_order(id, Side::Buy, limitTicks, qty, false, EventType::Buy);
+    }
+
+    void place_sell(SymbolId id, int64_t limitTicks, int tick, bool immediateOrCancel) {
+        cancel_order(workingBuy[id], id);
+        cancel_order(workingSell[id], id);
+        int64_t qty = state.shares[id] - sellCommitted[id];
+        if (qty <= 0) return;
+        sellCommitted[id] += qty;
+        sellPlacedTick[id] = tick;
+        send_order(id, Side::Sell, limitTicks, qty, immediateOrCancel, immediateOrCancel ? EventType::AlertSell : EventType::Sell);
+    }
+
+    // Book mode, every tick for every symbol: a synchronous venue runs its flow, which may fill our resting
+    // orders, and orders older than ORDER_TTL_TICKS are pulled.
+    void work_orders(SymbolId id, double price, int tick) {
+        gateway->on_market_data(id, price, tick);
+        if (workingBuy[id] && tick - buyPlacedTick[id] >= ORDER_TTL_TICKS) cancel_order(workingBuy[id], id);
+        if (workingSell[id] && tick - sellPlacedTick[id] >= ORDER_TTL_TICKS) cancel_order(workingSell[id], id);
+    }
+
+    // With a hedging policy, every buy also buys its protective options, each only if the cash covers it.
+    void buy_hedge(SymbolId id, double price, int tick) {
+        auto& pos = portfolio[id];
+        double strike = Hedge::call_strike(params, price);// from params.callStrike, out of the money above 1
+        double callPremium = call_price(price, strike, OPTION_MATURITY, OPTION_RATE, OPTION_VOL);
+        if (balance >= Money::from_dollars(callPremium)) {
+            balance -= Money::from_dollars(callPremium);
+            OptionContract opt = {strike, callPremium, OPTION_MATURITY, true, tick};
+            if (optionMarking) opt.markSlot = optionsBook.add(id, opt);
+            pos.optionsHeld.add(opt);
+            emit({EventType::BuyCall, id, 1, tick, strike, callPremium});
+        }
+
+        double putStrike = Hedge::put_strike(params, price);
+        double putPremium = put_price(price, putStrike, OPTION_MATURITY, OPTION_RATE, OPTION_VOL);
+        if (balance >= Money::from_dollars(putPremium)) {
+            balance -= Money::from_dollars(putPremium);
+            OptionContract opt = {putStrike, putPremium, OPTION_MATURITY, false, tick};
+            if (optionMarking) opt.markSlot = optionsBook.add(id, opt);
+            pos.optionsHeld.add(opt);
+            emit({EventType::BuyPut, id, 1, tick, putStrike, putPremium});
+        }
+    }
+
+    // Scripted engines: runs the rules for symbols first .. first + n - 1, prices pointing at the first.
+    void evaluate_rules(SymbolId first, const double* prices, size_t n, int tick) {
+        if constexpr (scripted) {
+            RuleInputs in{prices, &state.sma[first], &state.avgPrice[first], &state.shares[first], tick};
+            rules.buy.run(in, n, &ruleBuy[first]);
+            rules.takeProfit.run(in, n, &ruleTakeProfit[first]);
+            rules.dropExit.run(in, n, &ruleDropExit[first]);
+        }
+    }
+
+    bool buy_signal(SymbolId id, double price, double sma) const {
+        if constexpr (scripted) return ruleBuy[id];
+        else return Signal::buy(params, price, sma);
+    }
+    bool take_profit(SymbolId id, double price, double sma, Money avgPrice) const {
+        if constexpr (scripted) return ruleTakeProfit[id];
+        else return Exit::take_profit(params, price, sma, avgPrice);
+    }
+    bool drop_exit(SymbolId id, double price, double sma, int tick) const {
+        if constexpr (scripted) return ruleDropExit[id];
+        else return Exit::drop_exit(params, price, sma, tick);
+    }
+
+    void trade(SymbolId id, double price, double sma, int tick) {
+        auto& pos = portfolio[id];
+        int64_t& shares = state.shares[id];
+        Money& avgPrice = state.avgPrice[id];
+        Money limitBuy = Money::from_dollars(price * (1.0 - params.limitSlippage));//you place a buy order only if it’s ≤ limitBuy
+        Money limitSell = Money::from_dollars(price * (1.0 + params.limitSlippage));
+        bool buySignal = buy_signal(id, price, sma);
+
+        if (gateway && buySignal) cancel_order(workingBuy[id], id);// re-quote at this tick's limit
+        if (buySignal && balance >= limitBuy) {
+            int64_t qty = Sizing::quantity(params, balance, limitBuy, positionSlots);// how many shares we can buy is qty
+            if (qty > 0) {
+                if (gateway) {
+                    place_buy(id, qty, limitBuy, tick);
+                } else {
+                    balance -= limitBuy * qty;
+                    avgPrice = (avgPrice * shares + limitBuy * qty).per(shares + qty);
+                    shares += qty;
+                    emit({EventType::Buy, id, qty, tick, limitBuy.dollars(), 0.0});
+                }
+                if constexpr (Hedge::buysOptions) buy_hedge(id, price, tick);
+            }
+        }
+
+        if (shares > 0 && take_profit(id, price, sma, avgPrice)) {
+            if (gateway) {
+                place_sell(id, book_ticks_at_or_above(limitSell), tick, false);
+            } else {
+                balance += limitSell * shares;
+                emit({EventType::Sell, id, shares, tick, limitSell.dollars(), 0.0});
+                shares = 0;
+                avgPrice = Money();
+            }
+        }
+
+        if (shares > 0 && drop_exit(id, price, sma, tick)) {
+            if (gateway) {// hits the bids down to limitBuy, whatever does not fill stays in the position
+                place_sell(id, book_ticks_at_or_below(limitBuy), tick, true);
+            } else {
+                balance += Money::from_dollars(price) * shares;
+                emit({EventType::AlertSell, id, shares, tick, price, 0.0});
+                shares = 0;
+                avgPrice = Money();
+            }
+        }
+
+        if (Hedge::exercise_tick(tick)) {
+            pos.optionsHeld.exercise(price, [&](const OptionContract& opt) {
+                double payout = opt.isCall ? price - opt.strike : opt.strike - price;
+                balance += Money::from_dollars(payout);
+                emit({opt.isCall ? EventType::AlertExitCall : EventType::AlertExitPut, id, 1, tick, payout, opt.strike});
+                if (optionMarking) optionsBook.remove(id, opt);
+            });
+        }
+        state.callTrigger[id] = pos.optionsHeld.call_trigger();
+        state.putTrigger[id] = pos.optionsHeld.put_trigger();
+    }
+
+public:
+    BasicTradingEngine(double startBalance, bool announce = true) : balance(Money::from_dollars(startBalance)) {
+        if constexpr (scripted) rules = default_rules();
+        if (!announce) return;
+        cout << fixed << setprecision(2);
+        cout << "Initial Balance: $" << balance.dollars() << endl;
+    }
+
+    // Route the strategy's orders to a gateway instead of filling them instantly at the limit price.
+    void set_order_gateway(OrderGateway* orderGateway) {
+        gateway = orderGateway;
+        gateway->deliver = [this](const ExecutionReport& report) { on_report(report); };
+    }
+
+    // Synchronous simulated limit order books with random flow.
+    void enable_order_book(uint64_t seed) {
+        ownedGateway = make_unique<SimulatedVenue>(seed);
+        set_order_gateway(ownedGateway.get());
+    }
+
+    void cancel_all_orders() {
+        if (!gateway) return;
+        for (SymbolId id = 0; id < workingBuy.size(); ++id) {
+            cancel_order(workingBuy[id], id);
+            cancel_order(workingSell[id], id);
+        }
+    }
+
+    size_t working_order_count() const { return workingOrders.size(); }
+
+    double cash() const { return balance.dollars(); }
+    Money cash_exact() const { return balance; }
+    void set_cash(double amount) { balance = Money::from_dollars(amount); }
+    void set_cash(Money amount) { balance = amount; }
+    void set_position_slots(double slots) { positionSlots = slots; }
+
+    // Before add_symbol: the SMA window sizes every symbol's history ring. A scripted engine rebuilds its
+    // default rules from the new thresholds; custom rules carry their own, so they must come after.
+    void set_strategy_params(const StrategyParams& strategyParams) {
+        if (!portfolio.empty()) throw runtime_error("strategy parameters must be set before symbols are added");
+        if (customRules) throw runtime_error("strategy parameters must be set before custom rules");
+        if (strategyParams.smaWindow < 1) throw runtime_error("SMA window must be at least one tick");
+        params = strategyParams;
+        state.window = size_t(params.smaWindow);
+        if constexpr (scripted) rules = default_rules(params);
+    }
+    const StrategyParams& strategy_params() const { return params; }
+
+    // Scripted engines only; replaces the rules they start with (default_rules of the engine's params).
+    void set_rules(RuleSet ruleSet) {
+        if constexpr (scripted) rules = move(ruleSet);
+        else throw runtime_error("only a ScriptedStrategy engine trades by rules");
+        customRules = true;
+    }
+
+    void set_event_log(LogChannel* channel) { eventLog = channel; }
+    void set_trace(vector<EventRecord>* sink) { trace = sink; }// every trade is also appended here, for cross-checks
+
+    // Off by default. When on, every price update also re-marks the held options and their Greeks.
+    void set_option_marking(bool enabled) {
+        optionMarking = enabled;
+        for (SymbolId id = 0; id < portfolio.size(); ++id) optionsBook.load(id, portfolio[id].optionsHeld);
+    }
+    void set_option_vol(SymbolId id, double sigma) { optionsBook.set_vol(id, sigma); }
+    const Greeks& symbol_greeks(SymbolId id) const { return optionsBook.symbol(id); }
+    Greeks portfolio_greeks() const { return optionsBook.total(); }
+    double option_pnl() const { return optionsBook.unrealized_pnl(); }
+    const OptionsBook& options_book() const { return optionsBook; }
+    const SymbolRegistry& symbol_registry() const { return symbols; }
+
+    SymbolId add_symbol(const string& company) {// call for every ticker at startup so the tick path never interns
+        SymbolId id = symbols.intern(company);
+        if (id == portfolio.size()) {
+            state.add_symbol();
+            actionable.push_back(0);
+            workingBuy.push_back(0);
+            workingSell.push_back(0);
+            buyPlacedTick.push_back(0);
+            sellPlacedTick.push_back(0);
+            sellCommitted.push_back(0);
+            if constexpr (scripted) {
+                ruleBuy.push_back(0);
+                ruleTakeProfit.push_back(0);
+                ruleDropExit.push_back(0);
+            }
+            optionsBook.add_symbol();
+            portfolio.emplace_back(&dayArena);
+            portfolio.back().company = company;
+        }
+        return id;
+    }
+
+    void update_price(const string& company, double price, int tick) {
+        update_price(add_symbol(company), price, tick);
+    }
+
+    void update_price(SymbolId id, double price, int tick) {
+        state.push_price(id, price);
+        currentTick = tick;
+        if (gateway) work_orders(id, price, tick);
+        if (state.ready(id)) {
+            evaluate_rules(id, &price, 1, tick);
+            trade(id, price, state.sma[id], tick);
+        }
+        if (optionMarking) optionsBook.refresh_symbol(id, price, tick);
+    }
+
+    // Cross-sectional update for the whole universe: prices[id] for ids 0..n-1, n == number of symbols.
+    // Produces the same trades as calling update_price for each id in order, but the history and signal
+    // passes are straight loops over the per-field arrays; only symbols that can act reach trade().
+    // smaRow, if given, is this tick's SMA for every symbol at the engine's window (see IndicatorCache);
+    // an engine fed that way must be fed that way on every tick.
+    void update_prices(int tick, const double* prices, size_t n, const double* smaRow = nullptr) {
+        if (gateway) {// every book sees flow every tick, so there is nothing to skip
+            for (size_t id = 0; id < n; ++id) update_price(SymbolId(id), prices[id], tick);
+            return;
+        }
+        if (smaRow) {
+            for (size_t id = 0; id < n; ++id) state.adopt_sma(id, smaRow[id]);
+        } else {
+            for (size_t id = 0; id < n; ++id) state.push_price(id, prices[id]);
+        }
+        evaluate_rules(0, prices, n, tick);
+
+        const double* sma = state.sma.data();
+        const int64_t* shares = state.shares.data();
+        const Money* avgPrice = state.avgPrice.data();
+        const double* callTrigger = state.callTrigger.data();
+        const double* putTrigger = state.putTrigger.data();
+        const uint32_t* samples = state.samples.data();
+        const uint32_t window = uint32_t(state.window);
+        const bool exitCheck = Hedge::exercise_tick(tick);
+        uint8_t* act = actionable.data();
+        for (size_t id = 0; id < n; ++id) {// branch-free so the compiler can vectorize it
+            bool buy = buy_signal(SymbolId(id), prices[id], sma[id]);
+            bool exit = (shares[id] > 0) & (take_profit(SymbolId(id), prices[id], sma[id], avgPrice[id]) |
+                                            drop_exit(SymbolId(id), prices[id], sma[id], tick));
+            bool optionExit = exitCheck & ((prices[id] > callTrigger[id]) | (prices[id] < putTrigger[id]));
+            act[id] = (samples[id] == window) & (buy | exit | optionExit);
+        }
+
+        for (size_t id = 0; id < n; ++id) {
+            if (act[id]) trade(SymbolId(id), prices[id], sma[id], tick);
+        }
+        if (optionMarking) optionsBook.refresh_all(tick, prices);
+    }
+
+    // With an asynchronous gateway, cancel_all_orders() and let the reports arrive before settling.
+    void end_of_day_settlement(const vector<double>& lastPrices) {// lastPrices is indexed by SymbolId
+        cancel_all_orders();
+        for (SymbolId id = 0; id < portfolio.size(); ++id) {
+            auto& pos = portfolio[id];
+            int64_t& shares = state.shares[id];
+            if (shares > 0) {
+                emit({EventType::EodSell, id, shares, TICKS_PER_DAY, lastPrices[id], 0.0});
+                balance += Money::from_dollars(lastPrices[id]) * shares;
+                shares = 0;
+                state.avgPrice[id] = Money();
+            }
+            pos.optionsHeld.exercise(lastPrices[id], [&](const OptionContract& opt) {
+                double payout = opt.isCall ? lastPrices[id] - opt.strike : opt.strike - lastPrices[id];
+                balance += Money::from_dollars(payout);
+                emit({EventType::OptionPayout, id, 1, TICKS_PER_DAY, opt.strike, payout});
+            });
+            pos.optionsHeld.release();// the rest expire worthless
+            optionsBook.clear(id);
+            state.callTrigger[id] = INFINITY;
+            state.putTrigger[id] = -INFINITY;
+        }
+        optionsBook.release();
+        dayArena.reset();
+    }
+
+    size_t arena_bytes() const { return dayArena.reserved_bytes(); }
+
+    void print_summary(double initialBalance) const {
+        cout << fixed << setprecision(2);
+        cout << "Final Balance: $" << balance.dollars() << endl;
+        double profitLoss = (balance - Money::from_dollars(initialBalance)).dollars();
+        cout << (profitLoss >= 0 ? "Profit: $" : "Loss: $") << abs(profitLoss) << endl;
+        for (SymbolId id = 0; id < portfolio.size(); ++id) {
+            if (state.shares[id] > 0) {
+                cout << portfolio[id].company << ": " << state.shares[id] << " shares held at avg $" << state.avgPrice[id].dollars() << endl;
+            }
+        }
+    }
+};
+
+using TradingEngine = BasicTradingEngine<>;
+
+// The strategy without protective options; vec-check holds it to the vectorized day with hedging off.
+using UnhedgedEngine = BasicTradingEngine<StrategyPolicies<BelowSmaSignal, CashSlotSizing, TakeProfitOrDropExit, NoHedge>>;
+
+// ---- Binary tick files ----
+// Layout: TickFileHeader, then recordCount TickRecords, then symbolCount zero-padded names of
+// TICK_SYMBOL_BYTES each at symbolTableOffset. The symbol table trails the records so the CSV
+// converter can stream records without knowing the universe up front. Records are 8-byte aligned
+// and read in place through mmap, so replay does no copying and no parsing.
+
+const char TICK_FILE_MAGIC[4] = {'T', 'K', 'B', '1'};
+const uint32_t TICK_FILE_VERSION = 1;
+const uint32_t TICK_PRICE_SCALE = 10000;// prices are stored in 1/10000 of a dollar
+const size_t TICK_SYMBOL_BYTES = 16;
+
+struct TickFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t symbolCount;
+    uint32_t priceScale;
+    uint64_t recordCount;
+    uint64_t symbolTableOffset;
+};
+
+struct TickRecord {
+    int64_t timestamp;// opaque, non-decreasing; every distinct value is one engine tick
+    uint32_t symbol;// index into the file's symbol table
+    int32_t price;// fixed-point, divide by the header's priceScale
+};
+
+static_assert(sizeof(TickFileHeader) == 32 && sizeof(TickRecord) == 16, "tick file layout is part of the format");
+
+class MappedTickFile {//read-only view of a tick file mapped into memory
+    const char* base = nullptr;
+    size_t length = 0;
+#if !HAVE_POSIX_MMAP
+    vector<char> storage;
+#endif
+
+public:
+    explicit MappedTickFile(const string& path) {
+#if HAVE_POSIX_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("cannot open " + path);
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < off_t(sizeof(TickFileHeader))) {
+            close(fd);
+            throw runtime_error(path + " is not a tick file");
+        }
+        length = size_t(info.st_size);
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) throw runtime_error("cannot map " + path);
+        base = static_cast<const char*>(mapped);
+        madvise(mapped, length, MADV_SEQUENTIAL);
+#else
+        FILE* in = fopen(path.c_str(), "rb");
+        if (!in) throw runtime_error("cannot open " + path);
+        char chunk[1 << 16];
+        size_t got;
+        while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) storage.insert(storage.end(), chunk, chunk + got);
+        fclose(in);
+        base = storage.data();
+        length = storage.size();
+#endif
+        // Each bound is checked before it is used in the next, so no sum can wrap.
+        const TickFileHeader& h = header();
+        if (length < sizeof(TickFileHeader) || memcmp(h.magic, TICK_FILE_MAGIC, 4) != 0 || h.version != TICK_FILE_VERSION
+            || h.priceScale == 0 || h.recordCount > (length - sizeof(TickFileHeader)) / sizeof(TickRecord)
+            || h.symbolTableOffset < sizeof(TickFileHeader) + h.recordCount * sizeof(TickRecord) || h.symbolTableOffset > length
+            || h.symbolCount > (length - h.symbolTableOffset) / TICK_SYMBOL_BYTES) {
+            release();
+            throw runtime_error(path + " is not a valid tick file");
+        }
+    }
+
+    ~MappedTickFile() { release(); }
+    MappedTickFile(const MappedTickFile&) = delete;
+    MappedTickFile& operator=(const MappedTickFile&) = delete;
+
+    void release() {
+#if HAVE_POSIX_MMAP
+        if (base) munmap(const_cast<char*>(base), length);
+#endif
+        base = nullptr;
+    }
+
+    const TickFileHeader& header() const { return *reinterpret_cast<const TickFileHeader*>(base); }
+    const TickRecord* begin() const { return reinterpret_cast<const TickRecord*>(base + sizeof(TickFileHeader)); }
+    const TickRecord* end() const { return begin() + header().recordCount; }
+    size_t size() const { return header().recordCount; }
+    size_t symbol_count() const { return header().symbolCount; }
+    double price_scale() const { return header().priceScale; }
+
+    string_view symbol_name(uint32_t index) const {
+        const char* name = base + header().symbolTableOffset + size_t(index) * TICK_SYMBOL_BYTES;
+        return string_view(name, strnlen(name, TICK_SYMBOL_BYTES));
+    }
+};
+
+class TickFileWriter {//streams records to disk and patches the header and symbol table in on finish()
+    string path;
+    FILE* out;
+    SymbolRegistry symbols;
+    uint64_t records = 0;
+
+public:
+    explicit TickFileWriter(const string& filePath) : path(filePath), out(fopen(path.c_str(), "wb")) {
+        if (!out) throw runtime_error("cannot create " + path);
+        TickFileHeader blank = {};
+        fwrite(&blank, sizeof(blank), 1, out);
+    }
+
+    ~TickFileWriter() {// a file that never reached finish() still has a blank header, so it is removed
+        if (!out) return;
+        fclose(out);
+        remove(path.c_str());
+    }
+
+    void write(int64_t timestamp, string_view symbol, double price) {
+        if (symbol.size() > TICK_SYMBOL_BYTES) throw runtime_error("symbol longer than 16 bytes: " + string(symbol));
+        double scaled = round(price * TICK_PRICE_SCALE);
+        if (!(scaled >= 0 && scaled <= INT32_MAX)) throw runtime_error("price out of range for " + string(symbol));
+        TickRecord record = {timestamp, symbols.intern(symbol), int32_t(scaled)};
+        fwrite(&record, sizeof(record), 1, out);
+        ++records;
+    }
+
+    void finish() {
+        TickFileHeader header = {};
+        memcpy(header.magic, TICK_FILE_MAGIC, 4);
+        header.version = TICK_FILE_VERSION;
+        header.symbolCount = uint32_t(symbols.size());
+        header.priceScale = TICK_PRICE_SCALE;
+        header.recordCount = records;
+        header.symbolTableOffset = sizeof(TickFileHeader) + records * sizeof(TickRecord);
+        for (SymbolId id = 0; id < symbols.size(); ++id) {
+            char name[TICK_SYMBOL_BYTES] = {};
+            memcpy(name, symbols.name(id).data(), symbols.name(id).size());
+            fwrite(name, sizeof(name), 1, out);
+        }
+        fseek(out, 0, SEEK_SET);
+        fwrite(&header, sizeof(header), 1, out);
+        bool failed = ferror(out) != 0;
+        failed = fclose(out) != 0 || failed;
+        out = nullptr;
+        if (failed) throw runtime_error("error writing tick file");
+    }
+
+    uint64_t size() const { return records; }
+};
+
+// ---- Streaming CSV ticks ----
+// Vendor files are read in CSV_CHUNK_BYTES chunks; each row is split in place with SSE2 byte compares
+// and parsed with from_chars, so memory stays bounded and no row allocates.
+
+const size_t CSV_CHUNK_BYTES = 1 << 22;
+const size_t CSV_MAX_ROW_BYTES = 4096;
+
+// First ',' or '\n' in [p, end), or end.
+inline const char* find_csv_delimiter(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; p + 16 <= end; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int hits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline)));
+        if (hits) return p + __builtin_ctz(hits);
+    }
+#endif
+    while (p < end && *p != ',' && *p != '\n') ++p;
+    return p;
+}
+
+struct CsvStats {
+    uint64_t rows = 0;
+    uint64_t rejected = 0;// malformed rows, skipped
+    uint64_t bytes = 0;
+    double seconds = 0.0;
+};
+
+class CsvTickReader {//"timestamp,symbol,price" rows; a first row that does not start with a digit is a header
+    FILE* in;
+    vector<char> buffer;
+
+public:
+    explicit CsvTickReader(const string& path) : in(fopen(path.c_str(), "rb")), buffer(CSV_CHUNK_BYTES + CSV_MAX_ROW_BYTES) {
+        if (!in) throw runtime_error("cannot open " + path);
+    }
+
+    ~CsvTickReader() { fclose(in); }
+    CsvTickReader(const CsvTickReader&) = delete;
+    CsvTickReader& operator=(const CsvTickReader&) = delete;
+
+    // Calls onRow(int64_t timestamp, string_view symbol, double price) for every well-formed row: an integer
+    // timestamp, a non-empty symbol and a finite positive price.
+    // The symbol view points into the read buffer and is only valid during the call.
+    template <class OnRow>
+    CsvStats for_each_row(OnRow&& onRow) {
+        CsvStats stats;
+        auto start = chrono::steady_clock::now();
+        size_t carried = 0;
+        bool firstRow = true;
+        bool eof = false;
+        while (!eof) {
+            size_t got = fread(buffer.data() + carried, 1, CSV_CHUNK_BYTES, in);
+            stats.bytes += got;
+            size_t filled = carried + got;
+            eof = got == 0;
+            if (eof && filled > 0 && buffer[filled - 1] != '\n') buffer[filled++] = '\n';// unterminated last row
+            const char* data = buffer.data();
+            const char* stop = data + filled;// just past the last complete row
+            while (stop > data && stop[-1] != '\n') --stop;
+            const char* p = data;
+            while (p < stop) {
+                const char* lineEnd = static_cast<const char*>(memchr(p, '\n', stop - p));
+                if (firstRow) {
+                    firstRow = false;
+                    if (!isdigit((unsigned char)*p) && *p != '-') {
+                        p = lineEnd + 1;
+                        continue;
+                    }
+                }
+                if (p + 1 >= lineEnd && (p == lineEnd || *p == '\r')) {// blank line
+                    p = lineEnd + 1;
+                    continue;
+                }
+                const char* c1 = find_csv_delimiter(p, lineEnd);
+                const char* c2 = c1 < lineEnd ? find_csv_delimiter(c1 + 1, lineEnd) : lineEnd;
+                const char* priceEnd = lineEnd > p && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+                int64_t timestamp;
+                double price;
+                bool ok = c2 < lineEnd && c2 > c1 + 1;// three fields, a non-empty symbol
+                if (ok) {// from_chars leaves the value unset on failure, and an empty field ends where it starts
+                    auto [timeEnd, timeError] = from_chars(p, c1, timestamp);
+                    auto [priceStop, priceError] = from_chars(c2 + 1, priceEnd, price);
+                    ok = timeError == errc() && timeEnd == c1 && priceError == errc() && priceStop == priceEnd && isfinite(price) && price > 0;
+                }
+                if (ok) {
+                    onRow(timestamp, string_view(c1 + 1, c2 - c1 - 1), price);
+                    ++stats.rows;
+                } else {
+                    ++stats.rejected;
+                }
+                p = lineEnd + 1;
+            }
+            carried = data + filled - stop;
+            if (carried > CSV_MAX_ROW_BYTES) throw runtime_error("CSV row longer than " + to_string(CSV_MAX_ROW_BYTES) + " bytes");
+            memmove(buffer.data(), stop, carried);
+        }
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+};
+
+CsvStats convert_csv_to_ticks(const string& csvPath, const string& tickPath) {
+    CsvTickReader reader(csvPath);
+    TickFileWriter writer(tickPath);
+    CsvStats stats = reader.for_each_row([&](int64_t timestamp, string_view symbol, double price) {
+        writer.write(timestamp, symbol, price);
+    });
+    writer.finish();
+    return stats;
+}
+
+struct TickClock {// turns a non-decreasing timestamp stream into engine tick indices
+    int tick = -1;
+    int64_t lastTimestamp = 0;
+
+    int advance(int64_t timestamp) {
+        if (tick < 0 || timestamp != lastTimestamp) {
+            ++tick;
+            lastTimestamp = timestamp;
+        }
+        return tick;
+    }
+};
+
+// Replays every record in file order; a new timestamp starts a new engine tick.
+// lastPrices is resized to the engine's symbol count and holds the final price of each symbol.
+void replay_ticks(const MappedTickFile& file, TradingEngine& engine, vector<double>& lastPrices) {
+    vector<SymbolId> ids(file.symbol_count());
+    for (uint32_t i = 0; i < ids.size(); ++i) ids[i] = engine.add_symbol(string(file.symbol_name(i)));
+    lastPrices.resize(engine.symbol_registry().size(), 0.0);
+    const double scale = file.price_scale();
+    TickClock clock;
+    for (const TickRecord& record : file) {
+        if (record.symbol >= ids.size()) {
+            throw runtime_error("tick record " + to_string(&record - file.begin()) + " names symbol " + to_string(record.symbol)
+                                + " of " + to_string(ids.size()));
+        }
+        SymbolId id = ids[record.symbol];
+        lastPrices[id] = record.price / scale;// divide, not multiply by 1/scale: gives the same double as parsing the CSV text
+        engine.update_price(id, lastPrices[id], clock.advance(record.timestamp));
+    }
+}
+
+// Feeds a CSV straight into the engine, same tick semantics as replay_ticks. Tickers not registered
+// beforehand are interned on first sight.
+CsvStats ingest_csv(const string& csvPath, TradingEngine& engine, vector<double>& lastPrices) {
+    CsvTickReader reader(csvPath);
+    TickClock clock;
+    lastPrices.resize(engine.symbol_registry().size(), 0.0);
+    return reader.for_each_row([&](int64_t timestamp, string_view symbol, double price) {
+        SymbolId id = engine.symbol_registry().find(symbol);
+        if (id == INVALID_SYMBOL) {
+            id = engine.add_symbol(string(symbol));
+            lastPrices.resize(id + 1, 0.0);
+        }
+        lastPrices[id] = price;
+        engine.update_price(id, price, clock.advance(timestamp));
+    });
+}
+
+// ---- Sharded engine ----
+// Symbols are split into contiguous id ranges, one per worker thread. Each shard is a full TradingEngine
+// that owns its slice of history and portfolio and trades against its own cash budget, so the tick path
+// shares nothing. Every reconcileEvery ticks the shards meet at a barrier and the pooled cash is
+// redistributed in proportion to shard size.
+
+class SpinBarrier {//reusable barrier; the last thread to arrive runs onComplete before releasing the others
+    const size_t parties;
+    atomic<size_t> waiting{0};
+    atomic<uint64_t> generation{0};
+
+public:
+    explicit SpinBarrier(size_t count) : parties(count) {}
+
+    template <class OnComplete>
+    void arrive_and_wait(OnComplete&& onComplete) {
+        uint64_t gen = generation.load(memory_order_acquire);
+        if (waiting.fetch_add(1, memory_order_acq_rel) + 1 == parties) {
+            onComplete();
+            waiting.store(0, memory_order_relaxed);
+            generation.fetch_add(1, memory_order_release);
+            return;
+        }
+        while (generation.load(memory_order_acquire) == gen) this_thread::yield();
+    }
+};
+
+bool pin_current_thread(size_t core) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % max(1u, thread::hardware_concurrency()), &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)core;
+    return false;
+#endif
+}
+
+struct ShardConfig {
+    size_t shards = max(1u, thread::hardware_concurrency());
+    bool pinCores = false;
+    int reconcileEvery = 12;// ticks between cash reconciliations, one hour at 5-minute ticks
+};
+
+class ShardedEngine {
+    struct Shard {
+        unique_ptr<TradingEngine> engine;
+        SymbolId begin = 0;// first global id owned by this shard
+        size_t count = 0;
+        LogChannel* log = nullptr;
+    };
+
+    SymbolRegistry symbols;// global ids
+    vector<Shard> shards;
+    ShardConfig config;
+    double initialBalance;
+
+    void reconcile() {// only runs while every shard waits at the barrier; the last shard takes the rounding remainder
+        Money total = cash_exact();
+        Money handedOut;
+        for (size_t k = 0; k < shards.size(); ++k) {
+            Money share = k + 1 == shards.size() ? total - handedOut// 128-bit product, so a large pool cannot overflow
+                                                 : Money::from_micros(int64_t(__int128(total.micros) * shards[k].count / int64_t(symbols.size())));
+            shards[k].engine->set_cash(share);
+            handedOut += share;
+        }
+    }
+
+public:
+    ShardedEngine(const vector<string>& companies, double startBalance, ShardConfig shardConfig)
+        : config(shardConfig), initialBalance(startBalance) {
+        for (const string& company : companies) symbols.intern(company);
+        size_t n = symbols.size();
+        if (n == 0) throw runtime_error("sharded engine needs at least one symbol");
+        config.shards = max<size_t>(1, min(config.shards, n));
+        for (size_t k = 0; k < config.shards; ++k) {
+            Shard shard;
+            shard.begin = SymbolId(k * n / config.shards);
+            shard.count = (k + 1) * n / config.shards - shard.begin;
+            shard.engine = make_unique<TradingEngine>(startBalance * shard.count / n, false);
+            // Same per-symbol sizing as one engine, but never below one slot: a fraction would size a buy
+            // past the shard's own cash.
+            shard.engine->set_position_slots(max(1.0, double(COMPANIES) * shard.count / n));
+            for (size_t i = 0; i < shard.count; ++i) shard.engine->add_symbol(symbols.name(SymbolId(shard.begin + i)));
+            shards.push_back(move(shard));
+        }
+    }
+
+    void set_event_log(AsyncLogger& logger) {// one channel per shard, over that shard's own registry
+        for (Shard& shard : shards) {
+            shard.log = logger.open_channel(shard.engine->symbol_registry());
+            shard.engine->set_event_log(shard.log);
+        }
+    }
+
+    size_t shard_count() const { return shards.size(); }
+    const SymbolRegistry& symbol_registry() const { return symbols; }
+
+    Money cash_exact() const {
+        Money total;
+        for (const Shard& shard : shards) total += shard.engine->cash_exact();
+        return total;
+    }
+    double cash() const { return cash_exact().dollars(); }
+
+    // prices is tick-major: prices[tick * symbols + id]. Runs every tick on every shard, then settles the day.
+    // The first exception from any shard is rethrown once every worker has joined.
+    void run_day(const vector<double>& prices, int ticks) {
+        const size_t n = symbols.size();
+        SpinBarrier barrier(shards.size());
+        mutex failureMutex;
+        exception_ptr failure;
+        atomic<bool> failed{false};
+        auto guarded = [&](auto&& step) {// after a failure every shard skips its work but still meets the barrier
+            if (failed.load(memory_order_acquire)) return;
+            try {
+                step();
+            } catch (...) {
+                lock_guard<mutex> lock(failureMutex);
+                if (!failure) failure = current_exception();
+                failed.store(true, memory_order_release);
+            }
+        };
+        auto work = [&](size_t k) {
+            if (config.pinCores) pin_current_thread(k);
+            Shard& shard = shards[k];
+            for (int tick = 0; tick < ticks; ++tick) {
+                guarded([&] { shard.engine->update_prices(tick, &prices[tick * n + shard.begin], shard.count); });
+                if (config.reconcileEvery > 0 && (tick + 1) % config.reconcileEvery == 0 && tick + 1 < ticks) {
+                    barrier.arrive_and_wait([&] { guarded([this] { reconcile(); }); });
+                }
+            }
+            guarded([&] {
+                const double* last = &prices[(ticks - 1) * n + shard.begin];
+                shard.engine->end_of_day_settlement(vector<double>(last, last + shard.count));
+            });
+        };
+        vector<thread> workers;
+        for (size_t k = 1; k < shards.size(); ++k) workers.emplace_back(work, k);
+        work(0);
+        for (thread& worker : workers) worker.join();
+        if (failure) rethrow_exception(failure);
+    }
+
+    void print_summary() const {
+        cout << fixed << setprecision(2);
+        cout << "Final Balance: $" << cash() << endl;
+        double profitLoss = cash() - initialBalance;
+        cout << (profitLoss >= 0 ? "Profit: $" : "Loss: $") << abs(profitLoss) << endl;
+    }
+};
+
+// ---- Market-data pipeline ----
+// Feed-handler threads publish TickEvents into a lock-free ring and a strategy thread drains it into the
+// engine, so decoding overlaps strategy evaluation. One feed uses the SpscRing, several share an MpscRing.
+// Each event carries its enqueue time so the strategy side can measure queue latency.
+
+template <class T>
+class MpscRing {//bounded multi-producer/single-consumer ring (Vyukov): producers claim slots with a CAS on head
+    struct alignas(CACHE_LINE) Cell {// one cell per line so producers filling neighbouring slots do not false-share
+        atomic<size_t> sequence;
+        T value;
+    };
+    unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(CACHE_LINE) atomic<size_t> head{0};
+    alignas(CACHE_LINE) size_t tail = 0;// consumer only
+
+public:
+    explicit MpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        cells = make_unique<Cell[]>(size);
+        for (size_t i = 0; i < size; ++i) cells[i].sequence.store(i, memory_order_relaxed);
+        mask = size - 1;
+    }
+
+    bool try_push(const T& value) {
+        size_t pos = head.load(memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells[pos & mask];
+            intptr_t diff = intptr_t(cell.sequence.load(memory_order_acquire)) - intptr_t(pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;// full
+            } else {
+                pos = head.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& out) {
+        Cell& cell = cells[tail & mask];
+        if (intptr_t(cell.sequence.load(memory_order_acquire)) - intptr_t(tail + 1) < 0) return false;
+        out = cell.value;
+        cell.sequence.store(tail + mask + 1, memory_order_release);
+        ++tail;
+        return true;
+    }
+};
+
+enum class WaitStrategy { BusyPoll, AdaptiveSpin };
+
+inline void cpu_relax() {
+#if HAVE_X86_SIMD
+    _mm_pause();
+#else
+    this_thread::yield();
+#endif
+}
+
+class Waiter {//call idle() whenever a poll finds nothing to do and reset() after progress
+    WaitStrategy strategy;
+    uint32_t spins = 0;
+
+public:
+    explicit Waiter(WaitStrategy waitStrategy) : strategy(waitStrategy) {}
+
+    void idle() {
+        if (strategy == WaitStrategy::BusyPoll || spins < 64) cpu_relax();
+        else if (spins < 256) this_thread::yield();
+        else this_thread::sleep_for(chrono::microseconds(20));
+        ++spins;
+    }
+
+    void reset() { spins = 0; }
+};
+
+inline int64_t now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TickEvent {
+    SymbolId symbol;
+    int32_t tick;
+    double price;
+    int64_t enqueuedNs;
+};
+
+class LatencyStats {//power-of-two histogram, percentiles are bucket upper bounds
+    uint64_t buckets[64] = {};
+    uint64_t count = 0;
+    double sumNs = 0.0;
+    int64_t maxNs = 0;
+
+public:
+    void record(int64_t ns) {
+        ns = max<int64_t>(ns, 0);
+        ++buckets[ns == 0 ? 0 : 64 - __builtin_clzll(uint64_t(ns))];
+        ++count;
+        sumNs += ns;
+        maxNs = max(maxNs, ns);
+    }
+
+    uint64_t samples() const { return count; }
+    double mean() const { return count ? sumNs / count : 0.0; }
+    int64_t max_ns() const { return maxNs; }
+
+    uint64_t percentile(double p) const {
+        uint64_t target = uint64_t(ceil(p * count)), seen = 0;
+        for (int b = 0; b < 64; ++b) {
+            seen += buckets[b];
+            if (seen >= target && seen > 0) return b == 0 ? 0 : min((uint64_t(1) << b) - 1, uint64_t(maxNs));
+        }
+        return uint64_t(maxNs);
+    }
+};
+
+struct PipelineConfig {
+    size_t feeds = 1;
+    WaitStrategy wait = WaitStrategy::AdaptiveSpin;
+    size_t queueCapacity = 1 << 16;
+    size_t lead = 64;// prices the feeds may publish ahead of the last one the strategy applied
+};
+
+struct PipelineStats {
+    uint64_t events = 0;
+    double seconds = 0.0;
+    LatencyStats latency;
+};
+
+// prices is tick-major as from MarketGenerator; feed k publishes ids [k*n/feeds, (k+1)*n/feeds) tick by tick.
+// The strategy applies prices in tick-major id order as they become contiguous, so any number of feeds
+// trades exactly as update_prices would. Feeds stay at most config.lead prices (and never a whole tick)
+// ahead of it, so a price cannot overtake its own symbol's previous one and queue latency is the handoff
+// rather than how far a feed ran ahead.
+template <class Queue>
+PipelineStats run_market_data_pipeline(Queue& queue, TradingEngine& engine, const vector<double>& prices,
+                                       size_t symbolCount, int ticks, const PipelineConfig& config) {
+    PipelineStats stats;
+    if (symbolCount == 0) return stats;
+    const uint64_t lead = clamp<uint64_t>(config.lead, 1, min(symbolCount, config.queueCapacity));
+    alignas(CACHE_LINE) atomic<uint64_t> applied{0};// prices applied, in tick-major order
+    auto publish = [&](size_t k) {
+        Waiter waiter(config.wait);
+        size_t begin = k * symbolCount / config.feeds, end = (k + 1) * symbolCount / config.feeds;
+        uint64_t seen = 0;
+        for (int tick = 0; tick < ticks; ++tick) {
+            for (size_t id = begin; id < end; ++id) {
+                const uint64_t sequence = uint64_t(tick) * symbolCount + id;
+                while (sequence >= seen + lead) {
+                    seen = applied.load(memory_order_acquire);
+                    if (sequence >= seen + lead) waiter.idle();
+                }
+                waiter.reset();
+                TickEvent event{SymbolId(id), tick, prices[sequence], now_ns()};
+                while (!queue.try_push(event)) waiter.idle();
+                waiter.reset();
+            }
+        }
+    };
+
+    auto start = chrono::steady_clock::now();
+    vector<thread> feeds;
+    for (size_t k = 0; k < config.feeds; ++k) feeds.emplace_back(publish, k);
+
+    vector<double> staged(symbolCount);
+    vector<int32_t> stagedTick(symbolCount, -1);
+    Waiter waiter(config.wait);
+    size_t next = 0;// first id of this tick not yet applied
+    TickEvent event;
+    for (int tick = 0; tick < ticks;) {
+        if (!queue.try_pop(event)) {
+            waiter.idle();
+            continue;
+        }
+        waiter.reset();
+        stats.latency.record(now_ns() - event.enqueuedNs);
+        staged[event.symbol] = event.price;
+        stagedTick[event.symbol] = event.tick;
+        for (; next < symbolCount && stagedTick[next] == tick; ++next) engine.update_price(SymbolId(next), staged[next], tick);
+        ++stats.events;
+        if (next == symbolCount) {
+            next = 0;
+            ++tick;
+        }
+        applied.store(uint64_t(tick) * symbolCount + next, memory_order_release);
+    }
+    for (thread& feed : feeds) feed.join();
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+// ---- Discrete-event exchange simulator ----
+// The strategy and the exchange run on one simulated clock. Market data reaches the strategy after a feed
+// delay, orders and cancels reach the exchange after a wire delay, and execution reports come back after
+// the matching delay plus the wire, so quotes can be stale, cancels can race fills, and the queue ahead
+// of a resting order is whatever the exchange saw when the order arrived.
+
+struct LatencyConfig {// one-way, in nanoseconds
+    int64_t wireNs = 20000;
+    int64_t exchangeNs = 5000;
+    int64_t marketDataNs = 10000;
+};
+
+const int64_t SIM_TICK_NS = 300000000000LL;// 72 ticks a day, 5 minutes apart
+const int64_t SIM_SYMBOL_STAGGER_NS = 1000;// symbols of one tick are published this far apart
+
+enum class SimEventType : uint8_t { ExchangeMarketData, StrategyMarketData, OrderArrival, CancelArrival, ReportDelivery };
+
+struct SimEvent {
+    int64_t time;
+    uint64_t seq;// ties on time go in scheduling order, which keeps runs deterministic
+    SimEventType type;
+    SymbolId symbol;
+    int tick;
+    double price;// market data
+    uint64_t clientId;// orders and cancels
+    Side side;
+    bool immediateOrCancel;
+    int64_t orderPrice;
+    int64_t qty;
+    ExecutionReport report;
+};
+
+class EventQueue {//binary min-heap on (time, seq)
+    vector<SimEvent> heap;
+    uint64_t nextSeq = 0;
+
+    static bool later(const SimEvent& a, const SimEvent& b) { return a.time != b.time ? a.time > b.time : a.seq > b.seq; }
+
+public:
+    void push(SimEvent event) {
+        event.seq = nextSeq++;
+        heap.push_back(event);
+        push_heap(heap.begin(), heap.end(), later);
+    }
+
+    SimEvent pop() {
+        pop_heap(heap.begin(), heap.end(), later);
+        SimEvent event = heap.back();
+        heap.pop_back();
+        return event;
+    }
+
+    const SimEvent& top() const { return heap.front(); }
+    bool empty() const { return heap.empty(); }
+};
+
+struct SimStats {
+    uint64_t events = 0;
+    uint64_t orders = 0;
+    uint64_t acks = 0;
+    double queueAheadSum = 0;// shares resting ahead of our orders when they were acked
+    double seconds = 0;
+};
+
+// Stands between the engine and a SimulatedVenue: the engine's submits and cancels become arrival events,
+// and the venue's reports become delivery events, instead of taking effect at once.
+class ExchangeSimulator : public OrderGateway {
+    TradingEngine& engine;
+    SimulatedVenue exchange;
+    LatencyConfig latency;
+    EventQueue queue;
+    int64_t now = 0;
+    SimStats stats;
+
+    void schedule(SimEvent event) { queue.push(event); }
+
+    void dispatch(const SimEvent& event) {
+        switch (event.type) {
+        case SimEventType::ExchangeMarketData: {
+            exchange.on_market_data(event.symbol, event.price, event.tick);// flow trades at exchange time
+            SimEvent seen = event;
+            seen.type = SimEventType::StrategyMarketData;
+            seen.time = now + latency.marketDataNs;
+            schedule(seen);
+            break;
+        }
+        case SimEventType::StrategyMarketData:
+            engine.update_price(event.symbol, event.price, event.tick);
+            break;
+        case SimEventType::OrderArrival:
+            exchange.submit(event.clientId, event.symbol, event.side, event.orderPrice, event.qty, event.immediateOrCancel);
+            break;
+        case SimEventType::CancelArrival:
+            exchange.cancel(event.clientId, event.symbol);
+            break;
+        case SimEventType::ReportDelivery:
+            deliver(event.report);
+            break;
+        }
+    }
+
+public:
+    ExchangeSimulator(TradingEngine& tradingEngine, LatencyConfig config, uint64_t seed)
+        : engine(tradingEngine), exchange(seed), latency(config) {
+        exchange.deliver = [this](const ExecutionReport& report) {
+            if (report.kind == ExecutionReport::Ack) {
+                ++stats.acks;
+                stats.queueAheadSum += report.qty;
+            }
+            SimEvent event{};
+            event.time = now + latency.exchangeNs + latency.wireNs;
+            event.type = SimEventType::ReportDelivery;
+            event.symbol = report.symbol;
+            event.report = report;
+            schedule(event);
+        };
+        engine.set_order_gateway(this);
+    }
+
+    void submit(uint64_t clientId, SymbolId symbol, Side side, int64_t price, int64_t qty, bool immediateOrCancel) override {
+        SimEvent event{};
+        event.time = now + latency.wireNs;
+        event.type = SimEventType::OrderArrival;
+        event.symbol = symbol;
+        event.clientId = clientId;
+        event.side = side;
+        event.immediateOrCancel = immediateOrCancel;
+        event.orderPrice = price;
+        event.qty = qty;
+        schedule(event);
+        ++stats.orders;
+    }
+
+    void cancel(uint64_t clientId, SymbolId symbol) override {
+        SimEvent event{};
+        event.time = now + latency.wireNs;
+        event.type = SimEventType::CancelArrival;
+        event.symbol = symbol;
+        event.clientId = clientId;
+        schedule(event);
+    }
+
+    void publish(SymbolId symbol, double price, int tick, int64_t time) {
+        SimEvent event{};
+        event.time = time;
+        event.type = SimEventType::ExchangeMarketData;
+        event.symbol = symbol;
+        event.tick = tick;
+        event.price = price;
+        schedule(event);
+    }
+
+    void run_until(int64_t time) {// processes every event strictly before time
+        while (!queue.empty() && queue.top().time < time) {
+            SimEvent event = queue.pop();
+            now = event.time;
+            ++stats.events;
+            dispatch(event);
+        }
+    }
+
+    // Publishes a tick-major price matrix one tick at a time, then pulls every working order and lets the
+    // cancels and reports play out so the engine's cash and positions are final.
+    SimStats run_session(const vector<double>& prices, size_t symbolCount, int ticks) {
+        for (size_t id = 0; id < symbolCount; ++id) {
+            double low = prices[id], high = prices[id];
+            for (int tick = 1; tick < ticks; ++tick) {
+                low = min(low, prices[tick * symbolCount + id]);
+                high = max(high, prices[tick * symbolCount + id]);
+            }
+            exchange.open_book(SymbolId(id), prices[id], low, high);
+        }
+        auto start = chrono::steady_clock::now();
+        for (int tick = 0; tick < ticks; ++tick) {
+            int64_t tickStart = tick * SIM_TICK_NS;
+            run_until(tickStart);
+            for (size_t id = 0; id < symbolCount; ++id) {
+                publish(SymbolId(id), prices[tick * symbolCount + id], tick, tickStart + int64_t(id) * SIM_SYMBOL_STAGGER_NS);
+            }
+        }
+        run_until(ticks * SIM_TICK_NS);
+        engine.cancel_all_orders();
+        run_until(INT64_MAX);
+        stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        return stats;
+    }
+};
+
+
+// ---- Synthetic market generator ----
+// Price paths for N symbols from xoshiro256++ streams, one stream per (day, symbol). A symbol's path
+// depends only on the seed, the day and its index, never on which thread made it or in what order, so
+// seeded runs are bit-identical for any thread count. Normals come from the inverse CDF (Wichura's
+// AS241) over blocks of uniforms; the AVX2 kernel and the scalar fallback share their exp/log arithmetic
+// and return the same bits.
+
+class Xoshiro256pp {
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    Xoshiro256pp(uint64_t seed, uint64_t stream) {
+        uint64_t x = seed ^ (stream * 0xD1342543DE82EF95ULL);
+        for (uint64_t& word : s) {// splitmix64, which never leaves the state all zero
+            uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t next() {
+        uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    double uniform() { return (double(next() >> 11) + 0.5) * 0x1.0p-53; }// open interval (0, 1)
+    uint32_t below(uint32_t bound) { return uint32_t((unsigned __int128)(next()) * bound >> 64); }
+};
+
+// AS241 (PPND16) coefficients: central region |p - 0.5| <= 0.425, then two tail segments in sqrt(-log p).
+const double PPND_A[8] = {3.3871328727963666080e0, 1.3314166789178437745e+2, 1.9715909503065514427e+3, 1.3731693765509461125e+4,
+                          4.5921953931549871457e+4, 6.7265770927008700853e+4, 3.3430575583588128105e+4, 2.5090809287301226727e+3};
+const double PPND_B[8] = {1.0, 4.2313330701600911252e+1, 6.8718700749205790830e+2, 5.3941960214247511077e+3,
+                          2.1213794301586595867e+4, 3.9307895800092710610e+4, 2.8729085735721942674e+4, 5.2264952788528545610e+3};
+const double PPND_C[8] = {1.42343711074968357734e0, 4.63033784615654529590e0, 5.76949722146069140550e0, 3.64784832476320460504e0,
+                          1.27045825245236838258e0, 2.41780725177450611770e-1, 2.27238449892691845833e-2, 7.74545014278341407640e-4};
+const double PPND_D[8] = {1.0, 2.05319162663775882187e0, 1.67638483018380384940e0, 6.89767334985100004550e-1,
+                          1.48103976427480074590e-1, 1.51986665636164571966e-2, 5.47593808499534494600e-4, 1.05075007164441684324e-9};
+const double PPND_E[8] = {6.65790464350110377720e0, 5.46378491116411436990e0, 1.78482653991729133580e0, 2.96560571828504891230e-1,
+                          2.65321895265761230930e-2, 1.24266094738807843860e-3, 2.71155556874348757815e-5, 2.01033439929228813265e-7};
+const double PPND_F[8] = {1.0, 5.99832206555887937690e-1, 1.36929880922735805310e-1, 1.48753612908506148525e-2,
+                          7.86869131145613259100e-4, 1.84631831751005468180e-5, 1.42151175831644588870e-7, 2.04426310338993978564e-15};
+const double PPND_SPLIT_CENTRAL = 0.425;
+const double PPND_SPLIT_TAIL = 5.0;
+
+inline double ppnd_ratio(const double* num, const double* den, double r) {
+    double n = num[7], d = den[7];
+    for (int k = 6; k >= 0; --k) {
+        n = fma(n, r, num[k]);
+        d = fma(d, r, den[k]);
+    }
+    return n / d;
+}
+
+inline double inverse_normal_cdf(double p) {// p in (0, 1)
+    double q = p - 0.5;
+    if (fabs(q) <= PPND_SPLIT_CENTRAL) return q * ppnd_ratio(PPND_A, PPND_B, fma(-q, q, 0.180625));
+    double r = sqrt(-log_portable(min(p, 1.0 - p)));
+    double z = r <= PPND_SPLIT_TAIL ? ppnd_ratio(PPND_C, PPND_D, r - 1.6) : ppnd_ratio(PPND_E, PPND_F, r - PPND_SPLIT_TAIL);
+    return q < 0 ? -z : z;
+}
+
+#if HAVE_X86_SIMD
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+
+static inline __m256d ppnd_ratio_avx2(const double* num, const double* den, __m256d r) {
+    __m256d n = _mm256_set1_pd(num[7]), d = _mm256_set1_pd(den[7]);
+    for (int k = 6; k >= 0; --k) {
+        n = _mm256_fmadd_pd(n, r, _mm256_set1_pd(num[k]));
+        d = _mm256_fmadd_pd(d, r, _mm256_set1_pd(den[k]));
+    }
+    return _mm256_div_pd(n, d);
+}
+
+// Every lane evaluates all three segments and blends, so there is no per-lane branching.
+size_t inverse_normal_cdf_avx2(const double* p, double* z, size_t n) {
+    const __m256d half = _mm256_set1_pd(0.5), signBit = _mm256_set1_pd(-0.0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d pv = _mm256_loadu_pd(p + i);
+        __m256d q = _mm256_sub_pd(pv, half);
+        __m256d central = _mm256_mul_pd(q, ppnd_ratio_avx2(PPND_A, PPND_B, _mm256_fnmadd_pd(q, q, _mm256_set1_pd(0.180625))));
+        __m256d tailMass = _mm256_min_pd(pv, _mm256_sub_pd(_mm256_set1_pd(1.0), pv));
+        __m256d r = _mm256_sqrt_pd(_mm256_xor_pd(log_avx2(tailMass), signBit));
+        __m256d nearTail = ppnd_ratio_avx2(PPND_C, PPND_D, _mm256_sub_pd(r, _mm256_set1_pd(1.6)));
+        __m256d farTail = ppnd_ratio_avx2(PPND_E, PPND_F, _mm256_sub_pd(r, _mm256_set1_pd(PPND_SPLIT_TAIL)));
+        __m256d tail = _mm256_blendv_pd(farTail, nearTail, _mm256_cmp_pd(r, _mm256_set1_pd(PPND_SPLIT_TAIL), _CMP_LE_OQ));
+        tail = _mm256_blendv_pd(tail, _mm256_xor_pd(tail, signBit), _mm256_cmp_pd(q, _mm256_setzero_pd(), _CMP_LT_OQ));
+        __m256d isCentral = _mm256_cmp_pd(_mm256_andnot_pd(signBit, q), _mm256_set1_pd(PPND_SPLIT_CENTRAL), _CMP_LE_OQ);
+        _mm256_storeu_pd(z + i, _mm256_blendv_pd(tail, central, isCentral));
+    }
+    return i;
+}
+
+size_t exp_avx2_array(const double* x, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, exp_avx2(_mm256_loadu_pd(x + i)));
+    return i;
+}
+
+#pragma GCC pop_options
+#endif
+
+void inverse_normal_cdf_batch(const double* p, double* z, size_t n, bool useSimd) {
+    size_t done = 0;
+#if HAVE_X86_SIMD
+    if (useSimd) done = inverse_normal_cdf_avx2(p, z, n);
+#endif
+    for (size_t i = done; i < n; ++i) z[i] = inverse_normal_cdf(p[i]);
+}
+
+void exp_batch(const double* x, double* out, size_t n, bool useSimd) {
+    size_t done = 0;
+#if HAVE_X86_SIMD
+    if (useSimd) done = exp_avx2_array(x, out, n);
+#endif
+    for (size_t i = done; i < n; ++i) out[i] = exp_portable(x[i]);
+}
+
+enum class MarketModelKind { UniformWalk, Gbm, JumpDiffusion };
+
+struct MarketModel {
+    MarketModelKind kind = MarketModelKind::UniformWalk;// the original walk: uniform -10%..+10% per tick
+    double drift = 0.05;// annualised, GBM and jump-diffusion
+    double volatility = 0.4;
+    double jumpsPerYear = 50.0;// jump-diffusion (Merton): Poisson arrivals with normal log sizes
+    double jumpMean = -0.01;
+    double jumpVol = 0.05;
+    double ticksPerYear = 252.0 * TICKS_PER_DAY;
+    bool centPrices = true;// round every price to cents, as a quote feed would
+};
+
+const char* market_model_name(MarketModelKind kind) {
+    switch (kind) {
+        case MarketModelKind::UniformWalk: return "walk";
+        case MarketModelKind::Gbm: return "gbm";
+        case MarketModelKind::JumpDiffusion: return "jump";
+    }
+    return "?";
+}
+
+const int JUMP_MAX_PER_TICK = 8;// Poisson inversion stops here; P(more) is negligible at any sane intensity
+
+class MarketGenerator {
+    MarketModel model;
+    uint64_t seed;
+    bool useSimd;
+
+    // One symbol's path for one day into out[tick * stride]. Uses only its own stream.
+    void generate_symbol(uint64_t day, size_t symbol, int ticks, double* out, size_t stride) const {
+        Xoshiro256pp rng(seed ^ (day * 0x9E3779B97F4A7C15ULL), symbol);
+        double price = 100 + rng.below(50);
+        if (model.kind == MarketModelKind::UniformWalk) {
+            for (int tick = 0; tick < ticks; ++tick) {
+                double change = (int(rng.below(201)) - 100) / 1000.0;
+                price = round(price * (1 + change) * 100.0) / 100.0;
+                out[size_t(tick) * stride] = price;
+            }
+            return;
+        }
+        const double dt = 1.0 / model.ticksPerYear;
+        const bool jumps = model.kind == MarketModelKind::JumpDiffusion;
+        const double lambda = jumps ? model.jumpsPerYear * dt : 0.0;// expected jumps per tick
+        const double compensator = jumps ? model.jumpsPerYear * (exp(model.jumpMean + 0.5 * model.jumpVol * model.jumpVol) - 1) : 0.0;
+        const double driftPerTick = (model.drift - 0.5 * model.volatility * model.volatility - compensator) * dt;
+        const double volPerTick = model.volatility * sqrt(dt);
+
+        vector<double> uniforms(size_t(ticks) * (jumps ? 3 : 1)), normals(uniforms.size()), path(ticks);
+        for (double& u : uniforms) u = rng.uniform();
+        inverse_normal_cdf_batch(uniforms.data(), normals.data(), jumps ? size_t(ticks) * 2 : size_t(ticks), useSimd);
+        double cumulative[JUMP_MAX_PER_TICK + 1];// Poisson CDF for the jump count inversion
+        double term = exp(-lambda);
+        cumulative[0] = term;
+        for (int k = 1; k <= JUMP_MAX_PER_TICK; ++k) cumulative[k] = cumulative[k - 1] + (term *= lambda / k);
+
+        double logPrice = 0.0;// a scan: each tick's log return adds to the last
+        for (int tick = 0; tick < ticks; ++tick) {
+            double step = driftPerTick + volPerTick * normals[tick];
+            if (jumps) {
+                double u = uniforms[2 * size_t(ticks) + tick];
+                int count = 0;
+                while (count < JUMP_MAX_PER_TICK && u > cumulative[count]) ++count;
+                // the sum of `count` normal log jumps is one normal with scaled mean and variance
+                if (count) step += count * model.jumpMean + sqrt(double(count)) * model.jumpVol * normals[ticks + tick];
+            }
+            logPrice += step;
+            path[tick] = logPrice;
+        }
+        exp_batch(path.data(), path.data(), path.size(), useSimd);
+        for (int tick = 0; tick < ticks; ++tick) {
+            double value = price * path[tick];
+            out[size_t(tick) * stride] = model.centPrices ? max(0.01, round(value * 100.0) / 100.0) : value;
+        }
+    }
+
+public:
+    MarketGenerator(MarketModel marketModel, uint64_t baseSeed, bool simd = cpu_has_avx2())
+        : model(marketModel), seed(baseSeed), useSimd(simd) {}
+
+    // Tick-major matrix [tick * symbols + id]. Symbols are split into contiguous ranges per thread.
+    vector<double> generate(size_t symbols, int ticks, uint64_t day = 0, size_t threads = 1) const {
+        vector<double> prices(symbols * size_t(ticks));
+        threads = max<size_t>(1, min(threads, symbols));
+        auto work = [&](size_t k) {
+            for (size_t id = k * symbols / threads; id < (k + 1) * symbols / threads; ++id) {
+                generate_symbol(day, id, ticks, &prices[id], symbols);
+            }
+        };
+        vector<thread> workers;
+        for (size_t k = 1; k < threads; ++k) workers.emplace_back(work, k);
+        work(0);
+        for (thread& worker : workers) worker.join();
+        return prices;
+    }
+};
+
+// ---- Multi-day backtest ----
+// Days are independent: each one starts a fresh engine at INITIAL_BALANCE and is flat after settlement,
+// so a date range is a bag of jobs for a work-stealing pool. Results land in a slot per date and are
+// merged in date order, which makes the report identical for any thread count or schedule.
+
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {// days since 1970-01-01, proleptic Gregorian
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = unsigned(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + int64_t(doe) - 719468;
+}
+
+string format_date(int64_t days) {// inverse of days_from_civil, as YYYY-MM-DD
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned doe = unsigned(days - era * 146097);
+    unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp = (5 * doy + 2) / 153;
+    unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    int64_t y = int64_t(yoe) + era * 400 + (m <= 2);
+    char text[32];
+    snprintf(text, sizeof(text), "%04lld-%02u-%02u", static_cast<long long>(y), m, d);
+    return text;
+}
+
+// proleptic Gregorian, m in 1..12
+unsigned days_in_month(unsigned y, unsigned m) {
+    static const unsigned length[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+    return m == 2 && leap ? 29 : length[m - 1];
+}
+
+int64_t parse_date(const string& text) {
+    unsigned y, m, d;
+    char tail;
+    if (sscanf(text.c_str(), "%4u-%2u-%2u%c", &y, &m, &d, &tail) != 3 || m < 1 || m > 12 || d < 1 || d > days_in_month(y, m)) {
+        throw runtime_error("bad date " + text + ", expected YYYY-MM-DD");
+    }
+    return days_from_civil(y, m, d);
+}
+
+bool is_weekday(int64_t days) { return (days % 7 + 7 + 3) % 7 < 5; }// 1970-01-01 was a Thursday
+
+// Where a backtest gets its days. play_day runs on pool threads, so implementations must not share
+// mutable state between calls.
+class DaySource {
+public:
+    virtual ~DaySource() = default;
+    // Feeds one day into a fresh engine and fills lastPrices (by SymbolId) for settlement. False if the
+    // source has no data for that date.
+    virtual bool play_day(int64_t date, TradingEngine& engine, vector<double>& lastPrices) const = 0;
+};
+
+// The default market for a date: every run of a backtest sees the same prices. Tick-major.
+vector<double> synthetic_day_prices(int64_t date, size_t symbolCount, uint64_t seed) {
+    return MarketGenerator(MarketModel(), seed).generate(symbolCount, TICKS_PER_DAY, uint64_t(date));
+}
+
+// sma, if given, is a matching tick-major SMA series at the engine's window.
+template <class Engine>
+void play_price_matrix(const vector<double>& prices, size_t symbolCount, Engine& engine, vector<double>& lastPrices,
+                       const double* sma = nullptr) {
+    for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+    int ticks = int(prices.size() / symbolCount);
+    for (int tick = 0; tick < ticks; ++tick) {
+        engine.update_prices(tick, &prices[tick * symbolCount], symbolCount, sma ? sma + tick * symbolCount : nullptr);
+    }
+    lastPrices.assign(prices.end() - symbolCount, prices.end());
+}
+
+class SyntheticDays : public DaySource {
+    size_t symbolCount;
+    uint64_t seed;
+
+public:
+    SyntheticDays(size_t symbols, uint64_t baseSeed = 0) : symbolCount(symbols), seed(baseSeed) {}
+
+    bool play_day(int64_t date, TradingEngine& engine, vector<double>& lastPrices) const override {
+        play_price_matrix(synthetic_day_prices(date, symbolCount, seed), symbolCount, engine, lastPrices);
+        return true;
+    }
+};
+
+class TickFileDays : public DaySource {//one binary tick file per day: <dir>/<YYYY-MM-DD>.bin, missing files are holidays
+    string dir;
+
+public:
+    explicit TickFileDays(string directory) : dir(move(directory)) {}
+
+    string path_of(int64_t date) const { return dir + "/" + format_date(date) + ".bin"; }
+
+    bool has_day(int64_t date) const {
+        FILE* probe = fopen(path_of(date).c_str(), "rb");
+        if (probe) fclose(probe);
+        return probe != nullptr;
+    }
+
+    bool play_day(int64_t date, TradingEngine& engine, vector<double>& lastPrices) const override {
+        if (!has_day(date)) return false;
+        MappedTickFile file(path_of(date));
+        replay_ticks(file, engine, lastPrices);
+        return true;
+    }
+};
+
+class WorkStealingPool {//runs a fixed batch of jobs; workers drain their own deque from the back and steal from the front of others
+    struct alignas(CACHE_LINE) WorkerQueue {
+        mutex lock;
+        deque<size_t> jobs;
+    };
+
+    size_t threads;
+    atomic<uint64_t> stolen{0};
+
+    static bool take(WorkerQueue& queue, bool back, size_t& job) {
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.jobs.empty()) return false;
+        if (back) {
+            job = queue.jobs.back();
+            queue.jobs.pop_back();
+        } else {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+        }
+        return true;
+    }
+
+public:
+    explicit WorkStealingPool(size_t threadCount) : threads(max<size_t>(1, threadCount)) {}
+
+    size_t thread_count() const { return threads; }
+    uint64_t steals() const { return stolen.load(memory_order_relaxed); }
+
+    // Calls job(index, worker) once for every index in [0, jobCount). Workers start with contiguous blocks
+    // (neighbouring days share cache-friendly inputs) and steal the oldest job of a busy neighbour when idle.
+    template <class Job>
+    void run(size_t jobCount, Job&& job) {
+        vector<unique_ptr<WorkerQueue>> queues;
+        for (size_t k = 0; k < threads; ++k) {
+            queues.push_back(make_unique<WorkerQueue>());
+            for (size_t i = k * jobCount / threads; i < (k + 1) * jobCount / threads; ++i) queues[k]->jobs.push_back(i);
+        }
+        auto work = [&](size_t k) {
+            size_t index;
+            for (;;) {
+                if (take(*queues[k], true, index)) {
+                    job(index, k);
+                    continue;
+                }
+                bool found = false;// no job is ever added, so one empty sweep over every victim means done
+                for (size_t step = 1; step < threads && !found; ++step) found = take(*queues[(k + step) % threads], false, index);
+                if (!found) return;
+                stolen.fetch_add(1, memory_order_relaxed);
+                job(index, k);
+            }
+        };
+        vector<thread> workers;
+        for (size_t k = 1; k < threads; ++k) workers.emplace_back(work, k);
+        work(0);
+        for (thread& worker : workers) worker.join();
+    }
+};
+
+struct DayResult {
+    int64_t date = 0;
+    bool traded = false;// false: no data for the date, or the day failed
+    double finalBalance = 0.0;
+    string error;
+};
+
+vector<DayResult> run_backtest(const DaySource& source, const vector<int64_t>& dates, WorkStealingPool& pool) {
+    vector<DayResult> results(dates.size());// one slot per date, so no two workers ever write the same result
+    pool.run(dates.size(), [&](size_t i, size_t) {
+        DayResult& result = results[i];
+        result.date = dates[i];
+        try {
+            TradingEngine engine(INITIAL_BALANCE, false);
+            vector<double> lastPrices;
+            if (!source.play_day(dates[i], engine, lastPrices)) return;
+            engine.end_of_day_settlement(lastPrices);
+            result.finalBalance = engine.cash();
+            result.traded = true;
+        } catch (const exception& e) {
+            result.error = e.what();
+        }
+    });
+    return results;
+}
+
+struct PnlSummary {
+    size_t traded = 0, wins = 0;
+    double total = 0.0, mean = 0.0, stdev = 0.0, maxDrawdown = 0.0;
+    double best = -INFINITY, worst = INFINITY;
+    int64_t bestDate = 0, worstDate = 0;
+
+    void add(int64_t date, double pnl) {// call in date order, drawdown follows the cumulative curve
+        ++traded;
+        wins += pnl > 0;
+        total += pnl;
+        sumSquares += pnl * pnl;
+        peak = max(peak, total);
+        maxDrawdown = max(maxDrawdown, peak - total);
+        if (pnl > best) {
+            best = pnl;
+            bestDate = date;
+        }
+        if (pnl < worst) {
+            worst = pnl;
+            worstDate = date;
+        }
+    }
+
+    void finish() {
+        if (traded == 0) return;
+        mean = total / traded;
+        stdev = sqrt(max(0.0, sumSquares / traded - mean * mean));
+    }
+
+    double sharpe() const { return stdev > 0 ? mean / stdev * sqrt(252.0) : 0.0; }// annualised from daily PnL
+
+private:
+    double sumSquares = 0.0, peak = 0.0;
+};
+
+// Date-ordered merge of per-day results; the sums run in date order, so the figures do not depend on
+// which worker finished first.
+void print_backtest_report(const vector<DayResult>& results, bool perDay) {
+    PnlSummary summary;
+    cout << fixed << setprecision(2);
+    for (const DayResult& day : results) {
+        if (!day.error.empty()) {
+            cerr << format_date(day.date) << ": " << day.error << endl;
+            continue;
+        }
+        if (!day.traded) continue;
+        double pnl = day.finalBalance - INITIAL_BALANCE;
+        summary.add(day.date, pnl);
+        if (perDay) cout << format_date(day.date) << "  PnL " << setw(12) << pnl << "  cumulative " << setw(14) << summary.total << endl;
+    }
+    summary.finish();
+    cout << "Days traded: " << summary.traded << " of " << results.size() << endl;
+    if (summary.traded == 0) return;
+    cout << "Total PnL: $" << summary.total << endl;
+    cout << "Mean daily PnL: $" << summary.mean << " (stdev $" << summary.stdev << ", win rate " << setprecision(1)
+         << 100.0 * summary.wins / summary.traded << "%)" << endl;
+    cout << setprecision(2) << "Best day: " << format_date(summary.bestDate) << " $" << summary.best << ", worst day: "
+         << format_date(summary.worstDate) << " $" << summary.worst << endl;
+    cout << "Max drawdown: $" << summary.maxDrawdown << endl;
+}
+
+// ---- Parameter sweep ----
+// Every candidate StrategyParams is replayed over the same days. The days are loaded once into a
+// MarketHistory that workers only read; each parameter set is one pool job that walks every day in
+// date order, so its figures match a backtest run with those parameters.
+
+class MarketHistory {
+    struct Day {
+        int64_t date;
+        vector<double> prices;// synthetic: tick-major matrix
+        unique_ptr<MappedTickFile> file;// tick files: mapped once, replayed by any number of threads
+    };
+    size_t symbolCount = 0;
+    vector<Day> days;
+
+public:
+    static MarketHistory synthetic(const vector<int64_t>& dates, size_t symbols, uint64_t seed = 0) {
+        MarketHistory history;
+        history.symbolCount = symbols;
+        for (int64_t date : dates) history.days.push_back({date, synthetic_day_prices(date, symbols, seed), nullptr});
+        return history;
+    }
+
+    static MarketHistory from_tick_files(const vector<int64_t>& dates, const TickFileDays& source) {// skips holidays
+        MarketHistory history;
+        for (int64_t date : dates) {
+            if (source.has_day(date)) history.days.push_back({date, {}, make_unique<MappedTickFile>(source.path_of(date))});
+        }
+        return history;
+    }
+
+    size_t day_count() const { return days.size(); }
+    size_t symbol_count() const { return symbolCount; }
+    int64_t date(size_t day) const { return days[day].date; }
+    bool has_matrix(size_t day) const { return !days[day].file; }
+    const vector<double>& prices(size_t day) const { return days[day].prices; }
+
+    void play(size_t day, TradingEngine& engine, vector<double>& lastPrices, const double* sma = nullptr) const {
+        const Day& d = days[day];
+        if (d.file) replay_ticks(*d.file, engine, lastPrices);
+        else play_price_matrix(d.prices, symbolCount, engine, lastPrices, sma);
+    }
+};
+
+// Indicator series computed once per dataset and shared by every sweep run. A series covers one day for
+// every symbol, tick-major like the price matrix it came from, so a run hands the engine one row per tick.
+// Lookups take a shared lock; a miss computes outside any lock and inserts under the exclusive one.
+// Entries carry a last-use stamp and the least recently used ones are dropped once the byte budget is
+// exceeded; runs still holding an evicted series keep it alive through their shared_ptr.
+
+enum class IndicatorType : uint8_t { Sma };
+
+struct IndicatorKey {
+    uint32_t day;
+    IndicatorType type;
+    uint32_t window;
+
+    bool operator==(const IndicatorKey& other) const { return day == other.day && type == other.type && window == other.window; }
+};
+
+struct IndicatorKeyHash {
+    size_t operator()(const IndicatorKey& key) const {
+        return hash<uint64_t>()((uint64_t(key.day) << 32) ^ (uint64_t(key.type) << 24) ^ key.window);
+    }
+};
+
+using IndicatorSeries = shared_ptr<const vector<double>>;
+
+class IndicatorCache {
+    struct Entry {
+        IndicatorSeries series;
+        mutable atomic<uint64_t> lastUse{0};
+    };
+
+    const MarketHistory& history;
+    size_t budgetBytes;
+    mutable shared_mutex lock;
+    unordered_map<IndicatorKey, unique_ptr<Entry>, IndicatorKeyHash> entries;
+    size_t bytes = 0;
+    atomic<uint64_t> clock{0}, hits{0}, misses{0}, evictions{0};
+
+    IndicatorSeries compute(const IndicatorKey& key) const {
+        switch (key.type) {
+        case IndicatorType::Sma: {
+            // Runs the engine's own running-sum SMA, so cached values are bit-identical to computing inline.
+            size_t symbols = history.symbol_count();
+            const vector<double>& prices = history.prices(key.day);
+            UniverseState state;
+            state.window = key.window;
+            for (size_t id = 0; id < symbols; ++id) state.add_symbol();
+            auto series = make_shared<vector<double>>(prices.size());
+            for (size_t row = 0; row < prices.size(); row += symbols) {
+                for (size_t id = 0; id < symbols; ++id) state.push_price(id, prices[row + id]);
+                copy(state.sma.begin(), state.sma.end(), series->begin() + row);
+            }
+            return series;
+        }
+        }
+        return nullptr;
+    }
+
+    void evict_over_budget() {// exclusive lock held
+        while (bytes > budgetBytes && entries.size() > 1) {
+            auto oldest = entries.begin();
+            for (auto it = entries.begin(); it != entries.end(); ++it) {
+                if (it->second->lastUse.load(memory_order_relaxed) < oldest->second->lastUse.load(memory_order_relaxed)) oldest = it;
+            }
+            bytes -= oldest->second->series->size() * sizeof(double);
+            entries.erase(oldest);
+            evictions.fetch_add(1, memory_order_relaxed);
+        }
+    }
+
+public:
+    IndicatorCache(const MarketHistory& marketHistory, size_t maxBytes) : history(marketHistory), budgetBytes(maxBytes) {}
+
+    // Tick-major series for every symbol of the day; only days backed by a price matrix have one.
+    IndicatorSeries get(size_t day, IndicatorType type, uint32_t window) {
+        IndicatorKey key{uint32_t(day), type, window};
+        {
+            shared_lock<shared_mutex> reading(lock);
+            auto it = entries.find(key);
+            if (it != entries.end()) {
+                it->second->lastUse.store(clock.fetch_add(1, memory_order_relaxed), memory_order_relaxed);
+                hits.fetch_add(1, memory_order_relaxed);
+                return it->second->series;
+            }
+        }
+        misses.fetch_add(1, memory_order_relaxed);
+        IndicatorSeries series = compute(key);
+        unique_lock<shared_mutex> writing(lock);
+        auto [it, inserted] = entries.try_emplace(key, nullptr);
+        if (!inserted) return it->second->series;// another run computed it first
+        it->second = make_unique<Entry>();
+        it->second->series = series;
+        it->second->lastUse.store(clock.fetch_add(1, memory_order_relaxed), memory_order_relaxed);
+        bytes += series->size() * sizeof(double);
+        evict_over_budget();
+        return series;
+    }
+
+    uint64_t hit_count() const { return hits.load(memory_order_relaxed); }
+    uint64_t miss_count() const { return misses.load(memory_order_relaxed); }
+    uint64_t eviction_count() const { return evictions.load(memory_order_relaxed); }
+    size_t resident_bytes() const {
+        shared_lock<shared_mutex> reading(lock);
+        return bytes;
+    }
+};
+
+struct SweepGrid {// every combination is one candidate; random sampling draws each field from its [min, max]
+    vector<int> smaWindows = {5, 10, 20};
+    vector<double> limitSlippages = {0.005, 0.01, 0.02};
+    vector<double> callStrikes = {1.03, 1.05, 1.10};
+    vector<double> putStrikes = {0.90, 0.95, 0.97};
+    vector<double> dropExits = {0.95, 0.97, 0.99};
+    vector<double> takeProfits = {1.005, 1.01, 1.02};
+};
+
+vector<StrategyParams> expand_grid(const SweepGrid& grid) {
+    vector<StrategyParams> sets;
+    for (int window : grid.smaWindows)
+        for (double slippage : grid.limitSlippages)
+            for (double call : grid.callStrikes)
+                for (double put : grid.putStrikes)
+                    for (double drop : grid.dropExits)
+                        for (double profit : grid.takeProfits) sets.push_back({window, slippage, call, put, drop, profit});
+    return sets;
+}
+
+vector<StrategyParams> sample_grid(const SweepGrid& grid, size_t count, uint64_t seed) {
+    mt19937_64 rng(seed);
+    auto uniform = [&](const vector<double>& axis) {
+        auto [lo, hi] = minmax_element(axis.begin(), axis.end());
+        return uniform_real_distribution<double>(*lo, *hi)(rng);
+    };
+    auto [minWindow, maxWindow] = minmax_element(grid.smaWindows.begin(), grid.smaWindows.end());
+    vector<StrategyParams> sets(count);
+    for (StrategyParams& params : sets) {
+        params.smaWindow = uniform_int_distribution<int>(*minWindow, *maxWindow)(rng);
+        params.limitSlippage = uniform(grid.limitSlippages);
+        params.callStrike = uniform(grid.callStrikes);
+        params.putStrike = uniform(grid.putStrikes);
+        params.dropExit = uniform(grid.dropExits);
+        params.takeProfit = uniform(grid.takeProfits);
+    }
+    return sets;
+}
+
+struct SweepResult {
+    size_t index = 0;// position in the candidate list, breaks ties so the ranking is stable
+    StrategyParams params;
+    PnlSummary summary;
+    string error;
+};
+
+// With a cache, matrix days take their SMA from it instead of every run recomputing it.
+vector<SweepResult> run_sweep(const MarketHistory& history, const vector<StrategyParams>& candidates, WorkStealingPool& pool,
+                              IndicatorCache* cache = nullptr) {
+    vector<SweepResult> results(candidates.size());
+    pool.run(candidates.size(), [&](size_t i, size_t) {
+        SweepResult& result = results[i];
+        result.index = i;
+        result.params = candidates[i];
+        try {
+            vector<double> lastPrices;
+            for (size_t day = 0; day < history.day_count(); ++day) {
+                TradingEngine engine(INITIAL_BALANCE, false);
+                engine.set_strategy_params(candidates[i]);
+                IndicatorSeries sma;
+                if (cache && history.has_matrix(day)) sma = cache->get(day, IndicatorType::Sma, uint32_t(candidates[i].smaWindow));
+                history.play(day, engine, lastPrices, sma ? sma->data() : nullptr);
+                engine.end_of_day_settlement(lastPrices);
+                result.summary.add(history.date(day), engine.cash() - INITIAL_BALANCE);
+            }
+            result.summary.finish();
+        } catch (const exception& e) {
+            result.error = e.what();
+        }
+    });
+    return results;
+}
+
+void rank_sweep(vector<SweepResult>& results) {// best Sharpe first, then total PnL; failed candidates last
+    sort(results.begin(), results.end(), [](const SweepResult& a, const SweepResult& b) {
+        if (a.error.empty() != b.error.empty()) return a.error.empty();
+        if (a.summary.sharpe() != b.summary.sharpe()) return a.summary.sharpe() > b.summary.sharpe();
+        if (a.summary.total != b.summary.total) return a.summary.total > b.summary.total;
+        return a.index < b.index;
+    });
+}
+
+void print_sweep_table(const vector<SweepResult>& ranked, size_t top) {
+    cout << "rank  sma  slip%   call    put   drop  profit      total PnL    mean/day   stdev/day  sharpe  win%     max DD" << endl;
+    for (size_t r = 0; r < min(top, ranked.size()); ++r) {
+        const SweepResult& result = ranked[r];
+        const StrategyParams& p = result.params;
+        cout << setw(4) << r + 1 << setw(5) << p.smaWindow << fixed << setprecision(2) << setw(7) << p.limitSlippage * 100
+             << setprecision(3) << setw(7) << p.callStrike << setw(7) << p.putStrike << setw(7) << p.dropExit << setw(8) << p.takeProfit;
+        if (!result.error.empty()) {
+            cout << "  error: " << result.error << endl;
+            continue;
+        }
+        const PnlSummary& s = result.summary;
+        cout << setprecision(2) << setw(15) << s.total << setw(12) << s.mean << setw(12) << s.stdev << setw(8) << s.sharpe()
+             << setprecision(1) << setw(6) << (s.traded ? 100.0 * s.wins / s.traded : 0.0) << setprecision(2) << setw(11)
+             << s.maxDrawdown << endl;
+    }
+}
+
+// ---- Vectorized day backtest ----
+// Research path for a whole day at once: takes the tick-major price matrix and replaces the per-tick
+// engine calls with passes over all symbols of a tick (SMA, signal masks) and over every buy candidate
+// of the day (option premiums through the batch pricer). Cash is shared by every symbol, so positions
+// and cash cannot be computed per column; they are one sequential scan over the cells the masks say can
+// act, in the engine's (tick, symbol) order, which is what makes its trades the engine's trades.
+
+const uint8_t CELL_BELOW_SMA = 1;// buy signal
+const uint8_t CELL_ABOVE_SMA = 2;// take-profit candidate
+const uint8_t CELL_DROP = 4;// drop-exit candidate on alert ticks
+
+struct VectorizedDay {
+    vector<EventRecord> trades;// same records, same order as the engine emits
+    double finalBalance = 0.0;
+};
+
+// SMA series of a tick-major matrix with the engine's running-sum arithmetic, so every value matches
+// UniverseState::push_price bit for bit, renormalisation included.
+vector<double> column_sma(const vector<double>& prices, size_t n, size_t window) {
+    size_t ticks = prices.size() / n;
+    vector<double> sma(prices.size()), windowSum(n, 0.0);
+    for (size_t t = 0; t < ticks; ++t) {
+        const double* row = &prices[t * n];
+        const double* old = t >= window ? row - window * n : nullptr;// the ring slot being overwritten
+        double* out = &sma[t * n];
+        if (old) {
+            for (size_t s = 0; s < n; ++s) windowSum[s] += row[s] - old[s];
+        } else {
+            for (size_t s = 0; s < n; ++s) windowSum[s] += row[s] - 0.0;
+        }
+        if ((t + 1) % SMA_RENORM_INTERVAL == 0) {// re-sum in ring slot order, as accumulate over the ring does
+            fill(windowSum.begin(), windowSum.end(), 0.0);
+            for (size_t slot = 0; slot < window; ++slot) {
+                const double* held = &prices[(t - (t + window - slot) % window) * n];// latest tick written to slot
+                for (size_t s = 0; s < n; ++s) windowSum[s] += held[s];
+            }
+        }
+        for (size_t s = 0; s < n; ++s) out[s] = windowSum[s] / window;
+    }
+    return sma;
+}
+
+// hedge = false plays the NoHedge composition: no options are priced or bought.
+VectorizedDay run_vectorized_day(const vector<double>& prices, size_t n, const StrategyParams& params,
+                                 double startBalance = INITIAL_BALANCE, double positionSlots = COMPANIES,
+                                 PricerMode pricer = PricerMode::Auto, bool hedge = true) {
+    const size_t window = size_t(params.smaWindow);
+    const size_t ticks = prices.size() / n;
+    const size_t firstReady = window - 1;
+    vector<double> sma = column_sma(prices, n, window);
+
+    vector<uint8_t> flags(prices.size(), 0);
+    for (size_t c = firstReady * n; c < prices.size(); ++c) {// branch-free so the compiler can vectorize it
+        flags[c] = uint8_t((prices[c] < sma[c]) * CELL_BELOW_SMA | (prices[c] > sma[c]) * CELL_ABOVE_SMA |
+                           (prices[c] < sma[c] * params.dropExit) * CELL_DROP);
+    }
+
+    // Premiums for every cell that may buy, priced in one batch; premiumAt maps a cell to its slot.
+    vector<uint32_t> premiumAt(prices.size(), 0);
+    vector<double> spot, callStrike, putStrike;
+    for (size_t c = 0; hedge && c < prices.size(); ++c) {
+        if (!(flags[c] & CELL_BELOW_SMA)) continue;
+        premiumAt[c] = uint32_t(spot.size());
+        spot.push_back(prices[c]);
+        callStrike.push_back(prices[c] * params.callStrike);
+        putStrike.push_back(prices[c] * params.putStrike);
+    }
+    size_t m = spot.size();
+    vector<double> maturity(m, OPTION_MATURITY), rate(m, OPTION_RATE), vol(m, OPTION_VOL);
+    vector<double> callPremium(m), putPremium(m), unused(m);
+    price_options_batch(spot.data(), callStrike.data(), maturity.data(), rate.data(), vol.data(), callPremium.data(), unused.data(), m, pricer);
+    price_options_batch(spot.data(), putStrike.data(), maturity.data(), rate.data(), vol.data(), unused.data(), putPremium.data(), m, pricer);
+
+    VectorizedDay day;
+    Money balance = Money::from_dollars(startBalance);
+    vector<int64_t> shares(n, 0);
+    vector<Money> avgPrice(n);
+    vector<OptionInventory> options(n);
+    auto emit = [&](const EventRecord& record) { day.trades.push_back(record); };
+    for (size_t t = firstReady; t < ticks; ++t) {
+        const int tick = int(t);
+        const bool exitCheck = tick % 2 == 0;
+        for (size_t s = 0; s < n; ++s) {
+            const size_t c = t * n + s;
+            const uint8_t f = flags[c];
+            if (!(f & CELL_BELOW_SMA) && shares[s] == 0 && !(exitCheck && !options[s].empty())) continue;
+            const SymbolId id = SymbolId(s);
+            const double price = prices[c];
+            Money limitBuy = Money::from_dollars(price * (1.0 - params.limitSlippage));
+            Money limitSell = Money::from_dollars(price * (1.0 + params.limitSlippage));
+            if ((f & CELL_BELOW_SMA) && balance >= limitBuy) {
+                int64_t qty = checked_quantity(balance.dollars() / limitBuy.dollars() / positionSlots);
+                if (qty > 0) {
+                    balance -= limitBuy * qty;
+                    avgPrice[s] = (avgPrice[s] * shares[s] + limitBuy * qty).per(shares[s] + qty);
+                    shares[s] += qty;
+                    emit({EventType::Buy, id, qty, tick, limitBuy.dollars(), 0.0});
+                    size_t k = premiumAt[c];
+                    if (hedge && balance >= Money::from_dollars(callPremium[k])) {
+                        balance -= Money::from_dollars(callPremium[k]);
+                        options[s].add({callStrike[k], callPremium[k], OPTION_MATURITY, true, tick});// same contract trade() books
+                        emit({EventType::BuyCall, id, 1, tick, callStrike[k], callPremium[k]});
+                    }
+                    if (hedge && balance >= Money::from_dollars(putPremium[k])) {
+                        balance -= Money::from_dollars(putPremium[k]);
+                        options[s].add({putStrike[k], putPremium[k], OPTION_MATURITY, false, tick});
+                        emit({EventType::BuyPut, id, 1, tick, putStrike[k], putPremium[k]});
+                    }
+                }
+            }
+            if ((f & CELL_ABOVE_SMA) && shares[s] > 0 && price > avgPrice[s].dollars() * params.takeProfit) {
+                balance += limitSell * shares[s];
+                emit({EventType::Sell, id, shares[s], tick, limitSell.dollars(), 0.0});
+                shares[s] = 0;
+                avgPrice[s] = Money();
+            }
+            if (exitCheck && (f & CELL_DROP) && shares[s] > 0) {
+                balance += Money::from_dollars(price) * shares[s];
+                emit({EventType::AlertSell, id, shares[s], tick, price, 0.0});
+                shares[s] = 0;
+                avgPrice[s] = Money();
+            }
+            if (exitCheck) {
+                options[s].exercise(price, [&](const OptionContract& opt) {
+                    double payout = opt.isCall ? price - opt.strike : opt.strike - price;
+                    balance += Money::from_dollars(payout);
+                    emit({opt.isCall ? EventType::AlertExitCall : EventType::AlertExitPut, id, 1, tick, payout, opt.strike});
+                });
+            }
+        }
+    }
+
+    const double* last = &prices[(ticks - 1) * n];
+    for (size_t s = 0; s < n; ++s) {// end_of_day_settlement
+        const SymbolId id = SymbolId(s);
+        if (shares[s] > 0) {
+            emit({EventType::EodSell, id, shares[s], TICKS_PER_DAY, last[s], 0.0});
+            balance += Money::from_dollars(last[s]) * shares[s];
+        }
+        options[s].exercise(last[s], [&](const OptionContract& opt) {
+            double payout = opt.isCall ? last[s] - opt.strike : opt.strike - last[s];
+            balance += Money::from_dollars(payout);
+            emit({EventType::OptionPayout, id, 1, TICKS_PER_DAY, opt.strike, payout});
+        });
+    }
+    day.finalBalance = balance.dollars();
+    return day;
+}
+
+
+int run_pricer_check() {// prices one random chain with every available kernel and compares against the scalar reference
+    const size_t n = 200000;
+    mt19937_64 gen(12345);
+    uniform_real_distribution<double> spot(50.0, 150.0), moneyness(0.7, 1.3), maturity(0.01, 2.0), rate(0.0, 0.05), vol(0.05, 0.8);
+    vector<double> S(n), K(n), T(n), r(n), sigma(n), refCalls(n), refPuts(n), calls(n), puts(n);
+    for (size_t i = 0; i < n; ++i) {
+        S[i] = spot(gen);
+        K[i] = S[i] * moneyness(gen);
+        T[i] = maturity(gen);
+        r[i] = rate(gen);
+        sigma[i] = i % 97 == 0 ? 0.0 : vol(gen);
+    }
+    price_options_batch(S.data(), K.data(), T.data(), r.data(), sigma.data(), refCalls.data(), refPuts.data(), n, PricerMode::Scalar);
+
+    double worst = 0.0;
+    cout << scientific << setprecision(3);
+    for (PricerMode mode : {PricerMode::Scalar, PricerMode::AVX2, PricerMode::AVX512}) {
+        if (resolve_pricer_mode(mode) != mode) {
+            cout << pricer_mode_name(mode) << ": not supported on this CPU" << endl;
+            continue;
+        }
+        auto start = chrono::steady_clock::now();
+        price_options_batch(S.data(), K.data(), T.data(), r.data(), sigma.data(), calls.data(), puts.data(), n, mode);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / n;
+        double maxErr = 0.0;
+        for (size_t i = 0; i < n; ++i) maxErr = max(maxErr, max(fabs(calls[i] - refCalls[i]), fabs(puts[i] - refPuts[i])));
+        worst = max(worst, maxErr);
+        cout << pricer_mode_name(mode) << ": " << ns << " ns/contract, max abs error " << maxErr << endl;
+    }
+    return worst < 1e-9 ? 0 : 1;
+}
+
+// Every Greeks kernel against the scalar reference and the scalar reference against central differences
+// of call_price/put_price, then the accuracy and cost of the incremental options book through a trading day.
+int run_greeks_check(size_t symbolCount) {
+    const size_t n = 200000;
+    mt19937_64 gen(12345);
+    uniform_real_distribution<double> spot(50.0, 150.0), moneyness(0.7, 1.3), maturity(0.01, 2.0), rate(0.0, 0.05), vol(0.05, 0.8);
+    vector<double> S(n), K(n), T(n), r(n), sigma(n);
+    vector<uint8_t> isCall(n);
+    for (size_t i = 0; i < n; ++i) {
+        S[i] = spot(gen);
+        K[i] = S[i] * moneyness(gen);
+        T[i] = maturity(gen);
+        if (i % 89 == 0) T[i] = i % 178 == 0 ? 0.0 : -T[i];// expired: at or past maturity
+        r[i] = rate(gen);
+        sigma[i] = i % 97 == 0 ? 0.0 : vol(gen);
+        isCall[i] = gen() & 1;
+    }
+    vector<Greeks> ref(n);
+    for (size_t i = 0; i < n; ++i) ref[i] = option_greeks(S[i], K[i], T[i], r[i], sigma[i], isCall[i]);
+
+    bool ok = true;
+    cout << scientific << setprecision(3);
+    vector<double> columns(6 * n);
+    OptionGreeksOut out = {&columns[0], &columns[n], &columns[2 * n], &columns[3 * n], &columns[4 * n], &columns[5 * n]};
+    for (PricerMode mode : {PricerMode::Scalar, PricerMode::AVX2, PricerMode::AVX512}) {
+        if (resolve_pricer_mode(mode) != mode) {
+            cout << pricer_mode_name(mode) << ": not supported on this CPU" << endl;
+            continue;
+        }
+        auto start = chrono::steady_clock::now();
+        option_greeks_batch(S.data(), K.data(), T.data(), r.data(), sigma.data(), isCall.data(), out, n, mode);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / n;
+        double maxErr = 0.0;// relative to the size of each Greek, vega and rho run into the hundreds
+        for (size_t i = 0; i < n; ++i) {
+            const double got[] = {out.value[i], out.delta[i], out.gamma[i], out.vega[i], out.theta[i], out.rho[i]};
+            const double want[] = {ref[i].value, ref[i].delta, ref[i].gamma, ref[i].vega, ref[i].theta, ref[i].rho};
+            for (int g = 0; g < 6; ++g) {
+                double err = fabs(got[g] - want[g]) / max(1.0, fabs(want[g]));
+                maxErr = max(maxErr, isnan(err) ? INFINITY : err);// max() would drop a NaN
+            }
+        }
+        ok = ok && maxErr < 1e-9;
+        cout << pricer_mode_name(mode) << ": " << ns << " ns/contract, max error " << maxErr << endl;
+    }
+
+    double worstDiff = 0.0;
+    for (size_t i = 0; i < n; i += 101) {
+        if (sigma[i] == 0 || T[i] <= 0) continue;
+        auto price = [&](double s, double t, double rr, double v) {
+            return isCall[i] ? call_price(s, K[i], t, rr, v) : put_price(s, K[i], t, rr, v);
+        };
+        double hS = S[i] * 1e-4, hT = min(1e-5, T[i] / 2), h = 1e-6;
+        double p0 = price(S[i], T[i], r[i], sigma[i]);
+        double up = price(S[i] + hS, T[i], r[i], sigma[i]), down = price(S[i] - hS, T[i], r[i], sigma[i]);
+        const double diffs[] = {
+            p0 - ref[i].value,
+            (up - down) / (2 * hS) - ref[i].delta,
+            (up - 2 * p0 + down) / (hS * hS) - ref[i].gamma,
+            (price(S[i], T[i], r[i], sigma[i] + h) - price(S[i], T[i], r[i], sigma[i] - h)) / (2 * h) - ref[i].vega,
+            -(price(S[i], T[i] + hT, r[i], sigma[i]) - price(S[i], T[i] - hT, r[i], sigma[i])) / (2 * hT) - ref[i].theta,
+            (price(S[i], T[i], r[i] + h, sigma[i]) - price(S[i], T[i], r[i] - h, sigma[i])) / (2 * h) - ref[i].rho};
+        for (double d : diffs) worstDiff = max(worstDiff, fabs(d));
+    }
+    ok = ok && worstDiff < 1e-3;
+    cout << "finite differences: max abs deviation " << worstDiff << endl;
+
+    // A GBM day at the options' own vol with the options book off and on. Half way through every vol moves
+    // by less than MARK_REPRICE_VOL, so the marks also take a vega step.
+    MarketModel model;
+    model.kind = MarketModelKind::Gbm;
+    model.volatility = OPTION_VOL;
+    vector<double> prices = MarketGenerator(model, 0).generate(symbolCount, TICKS_PER_DAY, 0);
+    double seconds[2] = {0.0, 0.0}, cash[2], worstMark = 0.0;
+    for (int marking = 0; marking < 2; ++marking) {
+        TradingEngine engine(INITIAL_BALANCE, false);
+        engine.set_option_marking(marking);
+        for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+        for (int tick = 0; tick < TICKS_PER_DAY; ++tick) {
+            if (marking && tick == TICKS_PER_DAY / 2) {
+                for (SymbolId id = 0; id < symbolCount; ++id) engine.set_option_vol(id, OPTION_VOL + 0.005);
+            }
+            auto start = chrono::steady_clock::now();
+            engine.update_prices(tick, &prices[tick * symbolCount], symbolCount);
+            seconds[marking] += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            if (marking) {// per contract, against repricing everything at this tick
+                const OptionsBook& book = engine.options_book();
+                double error = fabs(engine.portfolio_greeks().value - book.exact_total().value);
+                worstMark = max(worstMark, error / max<size_t>(1, book.contract_count()));
+            }
+        }
+        cash[marking] = engine.cash();
+        if (!marking) continue;
+        const OptionsBook& book = engine.options_book();
+        Greeks total = engine.portfolio_greeks();
+        double taylorShare = 100.0 * book.taylor_count() / max<size_t>(1, book.taylor_count() + book.repriced_count());
+        cout << fixed << setprecision(2) << book.contract_count() << " contracts held at the close: mark " << total.value
+             << ", unrealized " << engine.option_pnl() << ", delta " << total.delta << ", gamma " << setprecision(4)
+             << total.gamma << ", vega " << setprecision(2) << total.vega << ", theta " << total.theta << ", rho "
+             << total.rho << endl;
+        cout << setprecision(1) << taylorShare << "% of marks by Taylor step, worst mark error " << scientific
+             << setprecision(3) << worstMark << " per contract" << endl;
+    }
+    ok = ok && cash[0] == cash[1] && worstMark < 1e-3;
+    cout << fixed << setprecision(2) << symbolCount << " symbols, " << TICKS_PER_DAY << " ticks: "
+         << seconds[0] * 1e6 / TICKS_PER_DAY << " us/tick unmarked, " << seconds[1] * 1e6 / TICKS_PER_DAY
+         << " us/tick with the options book" << (cash[0] == cash[1] ? "" : " (trades differ!)") << endl;
+    return ok ? 0 : 1;
+}
+
+// Plays two warm-up days through one engine per fill mode, then the first day again, counting heap
+// allocations on that replay's tick path and in the settlement that resets the day arena; both must be
+// zero. Every day starts from the same cash, or the compounding balance makes each day busier than the
+// last; a day busier than any before it may still grow the arena and the order pools once.
+int run_alloc_check(size_t symbolCount) {
+    const struct { const char* name; bool orderBook, marking; } modes[] = {
+        {"instant fills", false, false}, {"instant fills + options book", false, true}, {"order book", true, false}};
+    vector<double> warm = synthetic_day_prices(0, symbolCount, 0), other = synthetic_day_prices(1, symbolCount, 0);
+    const vector<double>* days[] = {&warm, &other, &warm};
+    bool ok = true;
+    for (const auto& mode : modes) {
+        TradingEngine engine(INITIAL_BALANCE, false);
+        if (mode.orderBook) engine.enable_order_book(1);
+        for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+        engine.set_option_marking(mode.marking);
+        vector<double> lastPrices(symbolCount);
+        uint64_t tickAllocations = 0, settleAllocations = 0;
+        for (const vector<double>* day : days) {
+            const vector<double>& prices = *day;
+            engine.set_cash(INITIAL_BALANCE);
+            uint64_t before = heapAllocations;
+            for (int tick = 0; tick < TICKS_PER_DAY; ++tick) engine.update_prices(tick, &prices[tick * symbolCount], symbolCount);
+            tickAllocations = heapAllocations - before;
+            lastPrices.assign(prices.end() - symbolCount, prices.end());
+            before = heapAllocations;
+            engine.end_of_day_settlement(lastPrices);
+            settleAllocations = heapAllocations - before;
+        }
+        ok = ok && tickAllocations == 0 && settleAllocations == 0;
+        cout << mode.name << ": " << tickAllocations << " allocations over " << TICKS_PER_DAY << " ticks x " << symbolCount
+             << " symbols, " << settleAllocations << " at settlement, arena " << (engine.arena_bytes() >> 10) << " KiB" << endl;
+    }
+    return ok ? 0 : 1;
+}
+
+// Prices a random chain at known vols, inverts it with every kernel and reprices at the solved vols.
+int run_implied_vol_check() {
+    const size_t n = 400000;
+    mt19937_64 gen(12345);
+    uniform_real_distribution<double> spot(50.0, 150.0), moneyness(0.7, 1.3), maturity(0.01, 2.0), rate(0.0, 0.05), vol(0.05, 0.8);
+    vector<double> S(n), K(n), T(n), r(n), sigma(n), calls(n), puts(n), premium(n), solved(n), repriced(n), unused(n);
+    vector<uint8_t> isCall(n);
+    for (size_t i = 0; i < n; ++i) {
+        S[i] = spot(gen);
+        K[i] = S[i] * moneyness(gen);
+        T[i] = maturity(gen);
+        r[i] = rate(gen);
+        sigma[i] = vol(gen);
+        isCall[i] = gen() & 1;
+    }
+    price_options_batch(S.data(), K.data(), T.data(), r.data(), sigma.data(), calls.data(), puts.data(), n, PricerMode::Scalar);
+    for (size_t i = 0; i < n; ++i) premium[i] = isCall[i] ? calls[i] : puts[i];
+
+    bool ok = true;
+    for (PricerMode mode : {PricerMode::Scalar, PricerMode::AVX2, PricerMode::AVX512}) {
+        if (resolve_pricer_mode(mode) != mode) {
+            cout << pricer_mode_name(mode) << ": not supported on this CPU" << endl;
+            continue;
+        }
+        auto start = chrono::steady_clock::now();
+        implied_vol_batch(premium.data(), S.data(), K.data(), T.data(), r.data(), isCall.data(), solved.data(), n, mode);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        // Deep out-of-the-money quotes carry a vega near zero and pin the vol only loosely, so the pass
+        // criterion is the repricing error; the vol error is reported for the quotes that have real vega.
+        price_options_batch(S.data(), K.data(), T.data(), r.data(), solved.data(), calls.data(), puts.data(), n, PricerMode::Scalar);
+        double priceErr = 0.0, volErr = 0.0;
+        size_t failed = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (std::isnan(solved[i])) {// fine only if the quote has no time value left in a double
+                double intrinsic = isCall[i] ? S[i] - K[i] * exp(-r[i] * T[i]) : K[i] * exp(-r[i] * T[i]) - S[i];
+                failed += premium[i] - max(0.0, intrinsic) > 1e-12;
+                continue;
+            }
+            priceErr = max(priceErr, fabs((isCall[i] ? calls[i] : puts[i]) - premium[i]));
+            if (option_greeks(S[i], K[i], T[i], r[i], sigma[i], isCall[i]).vega > 1e-2) volErr = max(volErr, fabs(solved[i] - sigma[i]));
+        }
+        ok = ok && failed == 0 && priceErr < 1e-9;
+        cout << pricer_mode_name(mode) << ": " << fixed << setprecision(2) << n / seconds / 1e6 << "M inversions/s, max reprice error "
+             << scientific << setprecision(3) << priceErr << ", max vol error " << volErr << ", " << failed << " failed" << endl;
+    }
+    return ok ? 0 : 1;
+}
+
+int run_cdf_check() {// error bound and ns/eval of every CDF tier against the libm reference
+    const struct { CdfTier tier; double bound; } tiers[] = {
+        {CdfTier::Reference, 0.0}, {CdfTier::Rational, 1e-7}, {CdfTier::Table, 1e-8}};
+    const int gridPoints = 2000001;
+    const size_t benchPoints = 1 << 22;
+    vector<double> inputs(benchPoints);
+    mt19937_64 gen(12345);
+    normal_distribution<double> dist(0.0, 2.0);
+    for (double& x : inputs) x = dist(gen);
+
+    bool ok = true;
+    for (const auto& t : tiers) {
+        double maxErr = 0.0, worstX = 0.0;
+        for (int i = 0; i < gridPoints; ++i) {
+            double x = -10.0 + 20.0 * i / (gridPoints - 1);
+            double err = fabs(normal_cdf(x, t.tier) - normal_cdf_reference(x));
+            if (err > maxErr) {
+                maxErr = err;
+                worstX = x;
+            }
+        }
+        auto start = chrono::steady_clock::now();
+        double sink = 0.0;// keeps the timed loop from being optimized away
+        for (double x : inputs) sink += normal_cdf(x, t.tier);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / benchPoints;
+        bool pass = maxErr <= t.bound;
+        ok = ok && pass;
+        cout << cdf_tier_name(t.tier) << ": max abs error " << scientific << setprecision(3) << maxErr
+             << " at x=" << fixed << setprecision(4) << worstX << ", " << setprecision(2) << ns << " ns/eval"
+             << (pass ? "" : " FAILED bound") << " (checksum " << sink << ")" << endl;
+    }
+    return ok ? 0 : 1;
+}
+
+void run_trading_day(bool orderBook) {
+    uint64_t seed = uint64_t(time(0));
+    TradingEngine engine(INITIAL_BALANCE);
+    AsyncLogger logger;// declared after the engine so it drains before the engine's registry goes away
+    if (orderBook) engine.enable_order_book(seed);
+    vector<string> companies = {"AAPL", "GOOGL", "AMZN", "MSFT", "TSLA"};
+    for (const string& company : companies) engine.add_symbol(company);
+    engine.set_event_log(logger.open_channel(engine.symbol_registry()));
+    vector<double> prices = MarketGenerator(MarketModel(), seed).generate(companies.size(), TICKS_PER_DAY);
+
+    for (int tick = 0; tick < TICKS_PER_DAY; ++tick) {
+        engine.update_prices(tick, &prices[tick * companies.size()], companies.size());
+    }
+
+    engine.end_of_day_settlement(vector<double>(prices.end() - companies.size(), prices.end()));
+    logger.flush();// the summary goes through cout and must follow every logged trade
+    engine.print_summary(INITIAL_BALANCE);
+}
+
+void report_csv_stats(const CsvStats& stats) {
+    double seconds = max(stats.seconds, 1e-9);
+    cerr << " in " << fixed << setprecision(3) << stats.seconds << "s (" << setprecision(0) << stats.rows / seconds
+         << " rows/s, " << setprecision(1) << stats.bytes / seconds / 1e6 << " MB/s)";
+    if (stats.rejected) cerr << ", " << stats.rejected << " malformed rows skipped";
+    cerr << endl;
+}
+
+int run_csv_to_ticks(const string& csvPath, const string& tickPath) {
+    CsvStats stats = convert_csv_to_ticks(csvPath, tickPath);
+    cerr << "wrote " << stats.rows << " ticks to " << tickPath;
+    report_csv_stats(stats);
+    return 0;
+}
+
+int run_csv_ingest(const string& csvPath) {
+    TradingEngine engine(INITIAL_BALANCE);
+    AsyncLogger logger;
+    engine.set_event_log(logger.open_channel(engine.symbol_registry()));
+    vector<double> lastPrices;
+    CsvStats stats = ingest_csv(csvPath, engine, lastPrices);
+    engine.end_of_day_settlement(lastPrices);
+    logger.flush();
+    engine.print_summary(INITIAL_BALANCE);
+    cerr << "ingested " << stats.rows << " rows";
+    report_csv_stats(stats);
+    return 0;
+}
+
+int run_replay(const string& tickPath) {
+    MappedTickFile file(tickPath);
+    TradingEngine engine(INITIAL_BALANCE);
+    AsyncLogger logger;
+    for (uint32_t i = 0; i < file.symbol_count(); ++i) engine.add_symbol(string(file.symbol_name(i)));// before logging starts
+    engine.set_event_log(logger.open_channel(engine.symbol_registry()));
+    vector<double> lastPrices;
+    auto start = chrono::steady_clock::now();
+    replay_ticks(file, engine, lastPrices);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    engine.end_of_day_settlement(lastPrices);
+    logger.flush();
+    engine.print_summary(INITIAL_BALANCE);
+    cerr << "replayed " << file.size() << " ticks in " << fixed << setprecision(3) << seconds << "s ("
+         << setprecision(0) << file.size() / max(seconds, 1e-9) << " ticks/s)" << endl;
+    return 0;
+}
+
+// Synthetic universe of `symbols` tickers on `shards` threads; trades are not logged when quiet is set.
+int run_sharded(size_t symbolCount, size_t shardCount, bool pinCores, bool quiet) {
+    vector<string> companies;
+    for (size_t i = 0; i < symbolCount; ++i) companies.push_back("SYM" + to_string(i));
+    vector<double> prices = MarketGenerator(MarketModel(), time(0)).generate(symbolCount, TICKS_PER_DAY);
+    ShardConfig config;
+    config.shards = shardCount;
+    config.pinCores = pinCores;
+    ShardedEngine engine(companies, INITIAL_BALANCE, config);
+    cout << fixed << setprecision(2) << "Initial Balance: $" << INITIAL_BALANCE << endl;
+    AsyncLogger logger;// declared after the engine so it drains before the shards' registries go away
+    if (!quiet) engine.set_event_log(logger);
+    auto start = chrono::steady_clock::now();
+    engine.run_day(prices, TICKS_PER_DAY);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    logger.flush();
+    engine.print_summary();
+    cerr << engine.shard_count() << " shards, " << symbolCount * TICKS_PER_DAY << " ticks in " << fixed << setprecision(3) << seconds
+         << "s (" << setprecision(0) << symbolCount * TICKS_PER_DAY / max(seconds, 1e-9) << " ticks/s)" << endl;
+    return 0;
+}
+
+int run_pipeline(size_t symbolCount, size_t feedCount, WaitStrategy wait, bool quiet) {
+    vector<double> prices = MarketGenerator(MarketModel(), time(0)).generate(symbolCount, TICKS_PER_DAY);
+    PipelineConfig config;
+    config.feeds = max<size_t>(1, min(feedCount, symbolCount));
+    config.wait = wait;
+    TradingEngine engine(INITIAL_BALANCE);
+    AsyncLogger logger;
+    for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+    if (!quiet) engine.set_event_log(logger.open_channel(engine.symbol_registry()));
+    PipelineStats stats;
+    if (config.feeds == 1) {
+        SpscRing<TickEvent> queue(config.queueCapacity);
+        stats = run_market_data_pipeline(queue, engine, prices, symbolCount, TICKS_PER_DAY, config);
+    } else {
+        MpscRing<TickEvent> queue(config.queueCapacity);
+        stats = run_market_data_pipeline(queue, engine, prices, symbolCount, TICKS_PER_DAY, config);
+    }
+    engine.end_of_day_settlement(vector<double>(prices.end() - symbolCount, prices.end()));
+    logger.flush();
+    engine.print_summary(INITIAL_BALANCE);
+    cerr << config.feeds << " feeds, " << stats.events << " ticks in " << fixed << setprecision(3) << stats.seconds << "s ("
+         << setprecision(0) << stats.events / max(stats.seconds, 1e-9) << " ticks/s); queue latency mean "
+         << stats.latency.mean() << "ns p50 <=" << stats.latency.percentile(0.5) << "ns p99 <="
+         << stats.latency.percentile(0.99) << "ns max " << stats.latency.max_ns() << "ns" << endl;
+    return 0;
+}
+
+int run_sim(size_t symbolCount, LatencyConfig latency, bool quiet) {
+    uint64_t seed = uint64_t(time(0));
+    vector<double> prices = MarketGenerator(MarketModel(), seed).generate(symbolCount, TICKS_PER_DAY);
+    TradingEngine engine(INITIAL_BALANCE);
+    AsyncLogger logger;
+    StrategyParams params;
+    params.limitSlippage = 2 * FLOW_QUOTE_STEP;// limits land on the venue's second quote level, behind its flow
+    engine.set_strategy_params(params);
+    for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+    if (!quiet) engine.set_event_log(logger.open_channel(engine.symbol_registry()));
+    ExchangeSimulator simulator(engine, latency, seed);
+    SimStats stats = simulator.run_session(prices, symbolCount, TICKS_PER_DAY);
+    engine.end_of_day_settlement(vector<double>(prices.end() - symbolCount, prices.end()));
+    logger.flush();
+    engine.print_summary(INITIAL_BALANCE);
+    cerr << stats.events << " events in " << fixed << setprecision(3) << stats.seconds << "s (" << setprecision(0)
+         << stats.events / max(stats.seconds, 1e-9) << " events/s), " << stats.orders << " orders, mean queue ahead "
+         << setprecision(1) << (stats.acks ? stats.queueAheadSum / stats.acks : 0.0) << " shares on "
+         << stats.acks << " resting orders" << endl;
+    return 0;
+}
+
+int run_backtest_range(const string& from, const string& to, size_t threads, const string& data, bool perDay) {
+    int64_t first = parse_date(from), last = parse_date(to);
+    if (first > last) throw runtime_error("bad date range " + from + " to " + to + ", expected the start on or before the end");
+    vector<int64_t> dates;
+    for (int64_t day = first; day <= last; ++day) {
+        if (is_weekday(day)) dates.push_back(day);
+    }
+    unique_ptr<DaySource> source;
+    if (!data.empty() && all_of(data.begin(), data.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+        source = make_unique<SyntheticDays>(stoul(data));
+    } else if (!data.empty()) {
+        source = make_unique<TickFileDays>(data);
+    } else {
+        source = make_unique<SyntheticDays>(COMPANIES);
+    }
+    WorkStealingPool pool(threads);
+    auto start = chrono::steady_clock::now();
+    vector<DayResult> results = run_backtest(*source, dates, pool);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    print_backtest_report(results, perDay);
+    cerr << dates.size() << " days on " << pool.thread_count() << " threads in " << fixed << setprecision(3) << seconds
+         << "s (" << setprecision(1) << dates.size() / max(seconds, 1e-9) << " days/s), " << pool.steals() << " steals" << endl;
+    return 0;
+}
+
+int run_sweep_range(const string& from, const string& to, size_t threads, const string& data, size_t randomSets, size_t top,
+                    size_t cacheBytes) {
+    vector<int64_t> dates;
+    for (int64_t day = parse_date(from); day <= parse_date(to); ++day) {
+        if (is_weekday(day)) dates.push_back(day);
+    }
+    bool synthetic = data.empty() || all_of(data.begin(), data.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); });
+    auto start = chrono::steady_clock::now();
+    MarketHistory history = synthetic ? MarketHistory::synthetic(dates, data.empty() ? COMPANIES : stoul(data))
+                                      : MarketHistory::from_tick_files(dates, TickFileDays(data));
+    double loadSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    SweepGrid grid;
+    vector<StrategyParams> candidates = randomSets ? sample_grid(grid, randomSets, 1) : expand_grid(grid);
+    WorkStealingPool pool(threads);
+    IndicatorCache cache(history, cacheBytes);
+    start = chrono::steady_clock::now();
+    vector<SweepResult> results = run_sweep(history, candidates, pool, cacheBytes ? &cache : nullptr);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    rank_sweep(results);
+    print_sweep_table(results, top);
+    cerr << candidates.size() << " parameter sets x " << history.day_count() << " days, loaded in " << fixed << setprecision(3)
+         << loadSeconds << "s, swept on " << pool.thread_count() << " threads in " << seconds << "s (" << setprecision(0)
+         << candidates.size() * history.day_count() / max(seconds, 1e-9) << " set-days/s)" << endl;
+    if (cacheBytes) {
+        cerr << "indicator cache: " << cache.hit_count() << " hits, " << cache.miss_count() << " misses, " << cache.eviction_count()
+             << " evictions, " << setprecision(1) << cache.resident_bytes() / 1048576.0 << " MiB resident" << endl;
+    }
+    return 0;
+}
+
+// Runs synthetic days through the event engine and the vectorized path and compares every trade, for the
+// default strategy and again for the unhedged composition. Quantities, ticks and event kinds must match
+// exactly; prices and cash may differ only by the batch pricer's rounding (see bs-check).
+int run_vectorized_check(size_t dayCount, size_t symbolCount) {
+    StrategyParams params;
+    double engineSeconds = 0.0, vectorSeconds = 0.0, worstCash = 0.0;
+    size_t trades = 0, mismatchedDays = 0;
+    auto close = [](double a, double b) { return fabs(a - b) <= 1e-9 * max(1.0, fabs(b)); };
+    // True if an engine's traced trades for day d match the vectorized day's.
+    auto compare = [&](size_t d, const vector<EventRecord>& engineTrades, double engineCash, const VectorizedDay& day, const char* label) {
+        bool same = engineTrades.size() == day.trades.size();
+        for (size_t i = 0; same && i < engineTrades.size(); ++i) {
+            const EventRecord& a = engineTrades[i];
+            const EventRecord& b = day.trades[i];
+            same = a.type == b.type && a.symbol == b.symbol && a.qty == b.qty && a.tick == b.tick && close(a.price, b.price) &&
+                   close(a.extra, b.extra);
+            if (!same) {
+                cerr << label << " day " << d << ": trade " << i << " differs (engine type " << int(a.type) << " symbol " << a.symbol
+                     << " qty " << a.qty << " tick " << a.tick << ", vectorized type " << int(b.type) << " symbol " << b.symbol
+                     << " qty " << b.qty << " tick " << b.tick << ")" << endl;
+            }
+        }
+        if (engineTrades.size() != day.trades.size()) {
+            cerr << label << " day " << d << ": " << engineTrades.size() << " engine trades, " << day.trades.size() << " vectorized" << endl;
+        }
+        worstCash = max(worstCash, fabs(engineCash - day.finalBalance));
+        trades += engineTrades.size();
+        return same;
+    };
+    for (size_t d = 0; d < dayCount; ++d) {
+        vector<double> prices = synthetic_day_prices(int64_t(d), symbolCount, 0);
+        vector<double> lastPrices;
+
+        auto start = chrono::steady_clock::now();
+        vector<EventRecord> engineTrades;
+        TradingEngine engine(INITIAL_BALANCE, false);
+        engine.set_trace(&engineTrades);
+        play_price_matrix(prices, symbolCount, engine, lastPrices);
+        engine.end_of_day_settlement(lastPrices);
+        engineSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        start = chrono::steady_clock::now();
+        VectorizedDay day = run_vectorized_day(prices, symbolCount, params);
+        vectorSeconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        vector<EventRecord> unhedgedTrades;
+        UnhedgedEngine unhedged(INITIAL_BALANCE, false);
+        unhedged.set_trace(&unhedgedTrades);
+        play_price_matrix(prices, symbolCount, unhedged, lastPrices);
+        unhedged.end_of_day_settlement(lastPrices);
+        VectorizedDay unhedgedDay = run_vectorized_day(prices, symbolCount, params, INITIAL_BALANCE, COMPANIES, PricerMode::Auto, false);
+
+        bool same = compare(d, engineTrades, engine.cash(), day, "hedged");
+        same = compare(d, unhedgedTrades, unhedged.cash(), unhedgedDay, "unhedged") && same;
+        mismatchedDays += !same;
+    }
+    cout << dayCount << " days x " << symbolCount << " symbols, hedged and unhedged, " << trades << " trades, " << mismatchedDays
+         << " days with differing trades, max cash difference " << scientific << setprecision(3) << worstCash << endl;
+    cout << fixed << setprecision(3) << "event engine " << engineSeconds << "s, vectorized " << vectorSeconds << "s ("
+         << setprecision(1) << engineSeconds / max(vectorSeconds, 1e-9) << "x)" << endl;
+    return mismatchedDays == 0 && worstCash < 1e-6 ? 0 : 1;
+}
+
+// Trades synthetic days with the compiled default strategy and with a ScriptedStrategy engine running the
+// default rules, which must agree trade for trade, then times the three conditions alone: the compiled
+// policies against the rule interpreter over the same columns. Odd days use tuned exit thresholds, which
+// the scripted engine must pick up from set_strategy_params.
+int run_rules_check(size_t symbolCount) {
+    const size_t dayCount = 20;
+    RuleSet rules = default_rules();
+    for (const RuleProgram* rule : {&rules.buy, &rules.takeProfit, &rules.dropExit}) {
+        cout << "\"" << rule->source() << "\": " << rule->instruction_count() << " instructions" << endl;
+    }
+
+    double seconds[2] = {0.0, 0.0};
+    size_t trades = 0, mismatchedDays = 0;
+    for (size_t d = 0; d < dayCount; ++d) {
+        vector<double> prices = synthetic_day_prices(int64_t(d), symbolCount, 0);
+        vector<double> lastPrices(prices.end() - symbolCount, prices.end());
+        vector<EventRecord> compiledTrades, scriptedTrades;
+        auto play = [&](auto& engine, vector<EventRecord>& trace, double& elapsed) {
+            for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+            engine.set_trace(&trace);
+            auto start = chrono::steady_clock::now();
+            for (int tick = 0; tick < TICKS_PER_DAY; ++tick) engine.update_prices(tick, &prices[tick * symbolCount], symbolCount);
+            engine.end_of_day_settlement(lastPrices);
+            elapsed += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            return engine.cash_exact();
+        };
+        TradingEngine compiled(INITIAL_BALANCE, false);
+        BasicTradingEngine<ScriptedStrategy> scripted(INITIAL_BALANCE, false);
+        if (d % 2) {
+            StrategyParams tuned;
+            tuned.takeProfit = 1.02;
+            tuned.dropExit = 0.95;
+            compiled.set_strategy_params(tuned);
+            scripted.set_strategy_params(tuned);
+        }
+        Money compiledCash = play(compiled, compiledTrades, seconds[0]);
+        Money scriptedCash = play(scripted, scriptedTrades, seconds[1]);
+        bool same = compiledCash == scriptedCash && compiledTrades.size() == scriptedTrades.size();
+        for (size_t i = 0; same && i < compiledTrades.size(); ++i) {
+            const EventRecord& a = compiledTrades[i];
+            const EventRecord& b = scriptedTrades[i];
+            same = a.type == b.type && a.symbol == b.symbol && a.qty == b.qty && a.tick == b.tick && a.price == b.price &&
+                   a.extra == b.extra;
+        }
+        if (!same) cerr << "day " << d << ": scripted trades differ from the compiled strategy" << endl;
+        mismatchedDays += !same;
+        trades += compiledTrades.size();
+    }
+    cout << dayCount << " days x " << symbolCount << " symbols, " << trades << " trades, " << mismatchedDays
+         << " days with differing trades" << endl;
+    cout << fixed << setprecision(3) << "compiled engine " << seconds[0] << "s, scripted " << seconds[1] << "s ("
+         << setprecision(2) << seconds[1] / max(seconds[0], 1e-9) << "x)" << endl;
+
+    // The conditions alone, over random columns, as the signal pass sees them.
+    mt19937_64 gen(7);
+    uniform_real_distribution<double> price(50.0, 150.0), drift(0.95, 1.05);
+    vector<double> px(symbolCount), sma(symbolCount);
+    vector<Money> avgPrice(symbolCount);
+    vector<int64_t> shares(symbolCount);
+    for (size_t i = 0; i < symbolCount; ++i) {
+        px[i] = price(gen);
+        sma[i] = px[i] * drift(gen);
+        shares[i] = gen() % 2 ? int(gen() % 100) : 0;
+        avgPrice[i] = shares[i] ? Money::from_dollars(px[i] * drift(gen)) : Money();
+    }
+    StrategyParams params;
+    vector<uint8_t> native(symbolCount), interpreted(symbolCount), buy(symbolCount), takeProfit(symbolCount), drop(symbolCount);
+    const int reps = int(max<size_t>(1, 20000000 / symbolCount));
+    auto start = chrono::steady_clock::now();
+    for (int rep = 0; rep < reps; ++rep) {
+        using Exit = DefaultStrategy::Exit;
+        for (size_t i = 0; i < symbolCount; ++i) {
+            bool b = DefaultStrategy::Signal::buy(params, px[i], sma[i]);
+            bool t = Exit::take_profit(params, px[i], sma[i], avgPrice[i]);
+            bool x = Exit::drop_exit(params, px[i], sma[i], rep);
+            native[i] = uint8_t(b | t << 1 | x << 2);
+        }
+    }
+    double nativeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    start = chrono::steady_clock::now();
+    for (int rep = 0; rep < reps; ++rep) {
+        RuleInputs in{px.data(), sma.data(), avgPrice.data(), shares.data(), rep};
+        rules.buy.run(in, symbolCount, buy.data());
+        rules.takeProfit.run(in, symbolCount, takeProfit.data());
+        rules.dropExit.run(in, symbolCount, drop.data());
+        for (size_t i = 0; i < symbolCount; ++i) interpreted[i] = uint8_t(buy[i] | takeProfit[i] << 1 | drop[i] << 2);
+    }
+    double ruleSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bool sameMasks = native == interpreted;// both hold the last rep
+    double perSymbol = 1e9 / (double(reps) * symbolCount);
+    cout << setprecision(2) << "conditions: compiled " << nativeSeconds * perSymbol << " ns/symbol, rules "
+         << ruleSeconds * perSymbol << " ns/symbol (" << ruleSeconds / max(nativeSeconds, 1e-12) << "x)"
+         << (sameMasks ? "" : " (results differ!)") << endl;
+
+    // More constants than the block program has operands, then one splatted for "120 - price".
+    string manyConstants;
+    for (int c = 1; c <= 20; ++c) manyConstants += "price > " + to_string(c) + " and ";
+    RuleProgram splat(manyConstants + "120 - price > 0");
+    splat.run(RuleInputs{px.data(), sma.data(), avgPrice.data(), shares.data(), 0}, symbolCount, buy.data());
+    size_t splatMismatches = 0;
+    for (size_t i = 0; i < symbolCount; ++i) splatMismatches += buy[i] != (px[i] > 20 && 120 - px[i] > 0);
+    cout << "20 constants, then \"120 - price > 0\": " << splat.instruction_count() << " instructions, " << splatMismatches
+         << " symbols differ" << endl;
+    return mismatchedDays == 0 && sameMasks && splatMismatches == 0 ? 0 : 1;
+}
+
+// Trades synthetic days by rules given on the command line. Every day starts from INITIAL_BALANCE, as in
+// the backtest, so one lucky day does not compound into the next.
+int run_rules(const string& buyRule, const string& takeProfitRule, const string& dropExitRule, size_t symbolCount) {
+    const size_t dayCount = 20;
+    BasicTradingEngine<ScriptedStrategy> engine(INITIAL_BALANCE, false);
+    engine.set_rules({RuleProgram(buyRule), RuleProgram(takeProfitRule), RuleProgram(dropExitRule)});
+    for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+    vector<EventRecord> trades;
+    engine.set_trace(&trades);
+    Money profitLoss;
+    for (size_t d = 0; d < dayCount; ++d) {
+        vector<double> prices = synthetic_day_prices(int64_t(d), symbolCount, 0);
+        engine.set_cash(INITIAL_BALANCE);
+        for (int tick = 0; tick < TICKS_PER_DAY; ++tick) engine.update_prices(tick, &prices[tick * symbolCount], symbolCount);
+        engine.end_of_day_settlement(vector<double>(prices.end() - symbolCount, prices.end()));
+        profitLoss += engine.cash_exact() - Money::from_dollars(INITIAL_BALANCE);
+    }
+    cout << dayCount << " days x " << symbolCount << " symbols, " << trades.size() << " trades" << endl;
+    cout << fixed << setprecision(2) << (profitLoss.micros >= 0 ? "Profit: $" : "Loss: $") << abs(profitLoss.dollars()) << endl;
+    return 0;
+}
+
+// Generates one day for many symbols, checks that the SIMD and scalar paths and every thread count give
+// the same bits, then trades the day.
+int run_market(size_t symbolCount, size_t threads, MarketModelKind kind, uint64_t seed) {
+    MarketModel model;
+    model.kind = kind;
+    MarketGenerator generator(model, seed);
+    auto start = chrono::steady_clock::now();
+    vector<double> prices = generator.generate(symbolCount, TICKS_PER_DAY, 0, threads);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    bool sameThreads = generator.generate(symbolCount, TICKS_PER_DAY, 0, 1) == prices;
+    bool sameScalar = MarketGenerator(model, seed, false).generate(symbolCount, TICKS_PER_DAY, 0, threads) == prices;
+    uint64_t checksum = 1469598103934665603ULL;// FNV-1a over the price bits
+    for (double price : prices) {
+        uint64_t bits;
+        memcpy(&bits, &price, sizeof(bits));
+        checksum = (checksum ^ bits) * 1099511628211ULL;
+    }
+    cerr << market_model_name(kind) << ": " << prices.size() << " prices on " << max<size_t>(1, min(threads, symbolCount))
+         << " threads in " << fixed << setprecision(3) << seconds << "s (" << setprecision(1) << prices.size() / max(seconds, 1e-9) / 1e6
+         << "M prices/s), checksum " << hex << checksum << dec << ", 1-thread " << (sameThreads ? "identical" : "DIFFERENT")
+         << ", scalar " << (sameScalar ? "identical" : "DIFFERENT") << endl;
+
+    TradingEngine engine(INITIAL_BALANCE);
+    for (size_t i = 0; i < symbolCount; ++i) engine.add_symbol("SYM" + to_string(i));
+    start = chrono::steady_clock::now();
+    for (int tick = 0; tick < TICKS_PER_DAY; ++tick) engine.update_prices(tick, &prices[tick * symbolCount], symbolCount);
+    engine.end_of_day_settlement(vector<double>(prices.end() - symbolCount, prices.end()));
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    engine.print_summary(INITIAL_BALANCE);
+    cerr << symbolCount * TICKS_PER_DAY << " ticks traded in " << setprecision(3) << seconds << "s (" << setprecision(0)
+         << symbolCount * TICKS_PER_DAY / max(seconds, 1e-9) << " ticks/s)" << endl;
+    return sameThreads && sameScalar ? 0 : 1;
+}
+
+int run_book_bench() {// add/cancel/modify/aggressive mix against one book
+    const int operations = 10000000;
+    const int64_t mid = to_book_ticks(100.0);
+    OrderBook book(100.0, BOOK_LEVELS, 1 << 16);
+    mt19937_64 rng(7);
+    vector<OrderId> live;
+    live.reserve(1 << 16);
+    auto passive = [&] {
+        bool buy = rng() % 2;
+        int64_t offset = 1 + int64_t(rng() % 50);
+        OrderId id = book.add(buy ? Side::Buy : Side::Sell, buy ? mid - offset : mid + offset, 1 + rng() % 500, FLOW_OWNER);
+        if (id != NO_ORDER && live.size() < live.capacity()) live.push_back(id);
+    };
+    for (int i = 0; i < 20000; ++i) passive();
+
+    uint64_t fills = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < operations; ++i) {
+        uint64_t roll = rng() % 100;
+        if (roll < 40 || live.empty()) {
+            passive();
+        } else if (roll < 80) {// cancel, ids of orders that already filled are simply stale
+            size_t k = rng() % live.size();
+            book.cancel(live[k]);
+            live[k] = live.back();
+            live.pop_back();
+        } else if (roll < 95) {
+            book.modify(live[rng() % live.size()], 1 + rng() % 500);
+        } else {
+            bool buy = rng() % 2;
+            book.cancel(book.add(buy ? Side::Buy : Side::Sell, buy ? mid + 10 : mid - 10, 1 + rng() % 2000, FLOW_OWNER));
+        }
+        fills += book.fills().size();
+        book.clear_fills();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << operations << " book operations in " << fixed << setprecision(3) << seconds << "s (" << setprecision(0)
+         << operations / seconds << " orders/s), " << fills << " fills, " << book.live_orders() << " resting" << endl;
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "bs-check") return run_pricer_check();
+    if (mode == "cdf-check") return run_cdf_check();
+    if (mode == "book-bench") return run_book_bench();
+    if (mode == "iv-check") return run_implied_vol_check();
+    if (mode == "alloc-check") return run_alloc_check(argc > 2 ? stoul(argv[2]) : 500);
+    if (mode == "greeks") return run_greeks_check(argc > 2 ? stoul(argv[2]) : COMPANIES);
+    if (mode == "rules-check") return run_rules_check(argc > 2 ? stoul(argv[2]) : 500);
+    if (mode == "vec-check") return run_vectorized_check(argc > 2 ? stoul(argv[2]) : 200, argc > 3 ? stoul(argv[3]) : COMPANIES);
+    if (mode == "book-day") {
+        run_trading_day(true);
+        return 0;
+    }
+    try {
+        if (mode == "rules" && argc >= 5) return run_rules(argv[2], argv[3], argv[4], argc > 5 ? stoul(argv[5]) : COMPANIES);
+        if (mode == "csv2bin" && argc == 4) return run_csv_to_ticks(argv[2], argv[3]);
+        if (mode == "replay" && argc == 3) return run_replay(argv[2]);
+        if (mode == "csv" && argc == 3) return run_csv_ingest(argv[2]);
+        if (mode == "sharded" && argc >= 4) {
+            bool pin = false, quiet = false;
+            for (int i = 4; i < argc; ++i) {
+                pin = pin || string(argv[i]) == "--pin";
+                quiet = quiet || string(argv[i]) == "--quiet";
+            }
+            return run_sharded(stoul(argv[2]), stoul(argv[3]), pin, quiet);
+        }
+        if (mode == "pipeline" && argc >= 4) {
+            WaitStrategy wait = WaitStrategy::AdaptiveSpin;
+            bool quiet = false;
+            for (int i = 4; i < argc; ++i) {
+                if (string(argv[i]) == "busy") wait = WaitStrategy::BusyPoll;
+                quiet = quiet || string(argv[i]) == "--quiet";
+            }
+            return run_pipeline(stoul(argv[2]), stoul(argv[3]), wait, quiet);
+        }
+        if (mode == "sim" && argc >= 3) {
+            LatencyConfig latency;
+            bool quiet = false;
+            vector<int64_t> micros;
+            for (int i = 3; i < argc; ++i) {
+                if (string(argv[i]) == "--quiet") quiet = true;
+                else micros.push_back(stoll(argv[i]));
+            }
+            if (micros.size() > 0) latency.wireNs = micros[0] * 1000;
+            if (micros.size() > 1) latency.exchangeNs = micros[1] * 1000;
+            return run_sim(stoul(argv[2]), latency, quiet);
+        }
+        if (mode == "market" && argc >= 4) {
+            MarketModelKind kind = MarketModelKind::UniformWalk;
+            uint64_t seed = uint64_t(time(0));
+            for (int i = 4; i < argc; ++i) {
+                string arg = argv[i];
+                if (arg == "gbm") kind = MarketModelKind::Gbm;
+                else if (arg == "jump") kind = MarketModelKind::JumpDiffusion;
+                else if (arg != "walk") seed = stoull(arg);
+            }
+            return run_market(stoul(argv[2]), stoul(argv[3]), kind, seed);
+        }
+        if (mode == "sweep" && argc >= 5) {
+            string data;
+            size_t randomSets = 0, top = 20, cacheMiB = 256;
+            for (int i = 5; i < argc; ++i) {
+                string arg = argv[i];
+                if (arg == "--random" && i + 1 < argc) randomSets = stoul(argv[++i]);
+                else if (arg == "--top" && i + 1 < argc) top = stoul(argv[++i]);
+                else if (arg == "--cache-mb" && i + 1 < argc) cacheMiB = stoul(argv[++i]);// 0 disables the cache
+                else data = arg;
+            }
+            return run_sweep_range(argv[2], argv[3], stoul(argv[4]), data, randomSets, top, cacheMiB << 20);
+        }
+        if (mode == "backtest" && argc >= 5) {
+            string data;
+            bool perDay = true;
+            for (int i = 5; i < argc; ++i) {
+                if (string(argv[i]) == "--quiet") perDay = false;
+                else data = argv[i];
+            }
+            return run_backtest_range(argv[2], argv[3], stoul(argv[4]), data, perDay);
+        }
+    } catch (const exception& e) {
+        cerr << "error: " << e.what() << endl;
+        return 1;
+    }
+    if (!mode.empty()) {
+        cerr << "usage: " << argv[0] << " [bs-check | cdf-check | iv-check | alloc-check [symbols] | greeks [symbols] | rules-check [symbols] | book-bench | book-day | csv2bin <in.csv> <out.bin> | replay <ticks.bin> | csv <ticks.csv>\n"
+             << "        | rules <buy> <take-profit> <drop-exit> [symbols]\n"
+             << "        | vec-check [days] [symbols] | market <symbols> <threads> [walk|gbm|jump] [seed]\n"
+             << "        | sharded <symbols> <shards> [--pin] [--quiet]\n"
+             << "        | pipeline <symbols> <feeds> [busy|adaptive] [--quiet]\n"
+             << "        | sim <symbols> [wire_us] [exchange_us] [--quiet]\n"
+             << "        | backtest <YYYY-MM-DD> <YYYY-MM-DD> <threads> [symbols | <ticks_dir>] [--quiet]\n"
+             << "        | sweep <YYYY-MM-DD> <YYYY-MM-DD> <threads> [symbols | <ticks_dir>] [--random <sets>] [--top <rows>]\n"
+             << "                [--cache-mb <MiB>]]" << endl;
+        return 2;
+    }
+    run_trading_day(false);
+    return 0;
+}